@@ -0,0 +1,259 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "bitboard.h"
+#include "data.h"
+
+// Attack sets include the first blocker in every direction whatever its colour, callers mask
+// out their own pieces when they want moves rather than attacks
+
+inline auto rook_attacks(const uint64_t rook, const uint64_t occupied) -> uint64_t
+{
+    const int pos = __builtin_ctzll(rook);
+    const int rank = pos >> 3;
+    const int file = pos & 7;
+    const int base = pos & ~7;
+    uint64_t attacks =
+        (uint64_t)(move_masks::sliding_moves[(((occupied >> (base + 1)) &
+                                               move_masks::sliding_moves_mask)
+                                              << 3) +
+                                             file])
+        << base;
+
+    const uint64_t file_isolated = occupied << (8 - file) & masks::file_h;
+    const uint64_t rotated = (file_isolated * masks::anti_diag) >> 56;
+    const uint64_t index = (rotated * 8 + (7 - rank)) & 0x1ff;
+    const uint64_t moves_rotated = ((uint64_t)move_masks::sliding_moves[index]) * masks::anti_diag;
+    attacks |= (moves_rotated & masks::file_a) >> (7 - file);
+
+    return attacks;
+}
+
+inline auto bishop_attacks(const uint64_t bishop, const uint64_t occupied) -> uint64_t
+{
+    uint64_t up_ray = 0;
+    uint64_t down_ray = 0;
+    uint64_t mask = 0;
+    uint64_t temp = 0;
+    uint64_t first_pc = 0;
+    uint64_t spots = 0;
+    const int pos = __builtin_ctzll(bishop);
+    up_ray = masks::diag_up[(pos & 7) + (pos >> 3)];
+    down_ray = masks::diag_down[7 + (pos >> 3) - (pos & 7)];
+
+    const uint64_t sqs_ahead = ~((bishop - 1) | bishop);
+    const uint64_t pcs_ahead = occupied & sqs_ahead;
+    const uint64_t pcs_behind = occupied & (bishop - 1);
+
+    first_pc = pcs_ahead & -(pcs_ahead & up_ray) & up_ray;
+    spots = ((first_pc - 1) & sqs_ahead & up_ray) | first_pc;
+
+    temp = pcs_behind & up_ray;
+    mask = static_cast<int>(temp == 0) - 1;
+    first_pc = (sq_a8 >> __builtin_clzll(temp)) & mask;
+    spots |= (bishop - 1) & ~(first_pc - 1) & up_ray;
+    spots |= up_ray & (bishop - 1) & ~mask;
+
+    first_pc = pcs_ahead & -(pcs_ahead & down_ray) & down_ray;
+    spots |= ((first_pc - 1) & sqs_ahead & down_ray) | first_pc;
+
+    temp = pcs_behind & down_ray;
+    mask = static_cast<int>(temp == 0) - 1;
+    first_pc = (sq_a8 >> __builtin_clzll(temp)) & mask;
+    spots |= (bishop - 1) & ~(first_pc - 1) & down_ray;
+    spots |= down_ray & (bishop - 1) & ~mask;
+    return spots;
+}
+
+// squares attacked by a set of pawns, also the squares enemy pawns attack a king from
+template <side_t Side>
+constexpr auto pawn_attacks(uint64_t pawns) -> uint64_t
+{
+    using traits = side_traits<Side>;
+    return (traits::forward(pawns, traits::a_side_capture) & ~masks::file_h) |
+           (traits::forward(pawns, traits::h_side_capture) & ~masks::file_a);
+}
+
+// squares attacked by a set of knights
+constexpr auto knight_attacks(uint64_t knights) -> uint64_t
+{
+    const uint64_t one_file = ((knights << 1) & ~masks::file_h) | ((knights >> 1) & ~masks::file_a);
+    const uint64_t two_files = ((knights << 2) & ~(masks::file_h | masks::file_g)) |
+                               ((knights >> 2) & ~(masks::file_a | masks::file_b));
+    return (one_file << 16) | (one_file >> 16) | (two_files << 8) | (two_files >> 8);
+}
+
+inline auto piece_attacks(const piece_t piece, const uint64_t sq, const uint64_t occupied)
+    -> uint64_t
+{
+    switch (piece)
+    {
+        case piece_t::white_pawn:
+            return pawn_attacks<side_t::white>(sq);
+        case piece_t::black_pawn:
+            return pawn_attacks<side_t::black>(sq);
+        case piece_t::white_knight:
+        case piece_t::black_knight:
+            return move_masks::knight_moves[__builtin_ctzll(sq)];
+        case piece_t::white_bishop:
+        case piece_t::black_bishop:
+            return bishop_attacks(sq, occupied);
+        case piece_t::white_rook:
+        case piece_t::black_rook:
+            return rook_attacks(sq, occupied);
+        case piece_t::white_queen:
+        case piece_t::black_queen:
+            return bishop_attacks(sq, occupied) | rook_attacks(sq, occupied);
+        case piece_t::white_king:
+        case piece_t::black_king:
+            return move_masks::king_moves[__builtin_ctzll(sq)];
+        default:
+            return 0;
+    }
+}
+
+namespace kogge_stone
+{
+// The fills are written once against a lane type providing 64 bit bitwise operations and shifts,
+// so gen_batch can run them over several positions at once. scalar_lanes is one position
+struct scalar_lanes
+{
+    using reg = uint64_t;
+    static constexpr size_t width = 1;
+
+    static constexpr auto load(const uint64_t *src) -> reg { return *src; }
+    static constexpr void store(uint64_t *dst, const reg value) { *dst = value; }
+    static constexpr auto set1(const uint64_t value) -> reg { return value; }
+    static constexpr auto and_(const reg a, const reg b) -> reg { return a & b; }
+    static constexpr auto or_(const reg a, const reg b) -> reg { return a | b; }
+    // ~a & b
+    static constexpr auto andnot(const reg a, const reg b) -> reg { return ~a & b; }
+    template <int Shift>
+    static constexpr auto shl(const reg a) -> reg
+    {
+        return a << Shift;
+    }
+    template <int Shift>
+    static constexpr auto shr(const reg a) -> reg
+    {
+        return a >> Shift;
+    }
+};
+
+// positive offsets shift left, negative ones right
+template <typename L, int Offset>
+constexpr auto shift(const typename L::reg squares) -> typename L::reg
+{
+    if constexpr (Offset > 0)
+    {
+        return L::template shl<Offset>(squares);
+    }
+    else
+    {
+        return L::template shr<-Offset>(squares);
+    }
+}
+
+// Occluded fill of every generator along one direction. wrap_mask removes squares that wrapped
+// round a file
+template <typename L, int Offset>
+constexpr auto fill(typename L::reg gen, typename L::reg empty, const typename L::reg wrap_mask) ->
+    typename L::reg
+{
+    empty = L::and_(empty, wrap_mask);
+    gen = L::or_(gen, L::and_(empty, shift<L, Offset>(gen)));
+    empty = L::and_(empty, shift<L, Offset>(empty));
+    gen = L::or_(gen, L::and_(empty, shift<L, 2 * Offset>(gen)));
+    empty = L::and_(empty, shift<L, 2 * Offset>(empty));
+    gen = L::or_(gen, L::and_(empty, shift<L, 4 * Offset>(gen)));
+    return L::and_(shift<L, Offset>(gen), wrap_mask);
+}
+
+constexpr auto slider_attacks_scalar(const uint64_t diagonal, const uint64_t straight,
+                                     const uint64_t occupied) -> uint64_t
+{
+    using L = scalar_lanes;
+    const uint64_t empty = ~occupied;
+    const uint64_t not_h = ~masks::file_h;
+    const uint64_t not_a = ~masks::file_a;
+    return fill<L, 8>(straight, empty, ~0ULL) | fill<L, -8>(straight, empty, ~0ULL) |
+           fill<L, 1>(straight, empty, not_h) | fill<L, -1>(straight, empty, not_a) |
+           fill<L, 9>(diagonal, empty, not_h) | fill<L, 7>(diagonal, empty, not_a) |
+           fill<L, -7>(diagonal, empty, not_h) | fill<L, -9>(diagonal, empty, not_a);
+}
+
+#ifdef __AVX2__
+// The same eight fills, run as four left shifting directions (north, west, north west, north
+// east) in one register and the four mirrored right shifting directions in another
+inline auto slider_attacks_avx2(const uint64_t diagonal, const uint64_t straight,
+                                const uint64_t occupied) -> uint64_t
+{
+    const auto not_h = static_cast<long long>(~masks::file_h);
+    const auto not_a = static_cast<long long>(~masks::file_a);
+    const auto diag = static_cast<long long>(diagonal);
+    const auto line = static_cast<long long>(straight);
+
+    // _mm256_set_epi64x takes its lanes from highest to lowest
+    const __m256i shift_1 = _mm256_set_epi64x(7, 9, 1, 8);
+    const __m256i shift_2 = _mm256_slli_epi64(shift_1, 1);
+    const __m256i shift_4 = _mm256_slli_epi64(shift_1, 2);
+    const __m256i wrap = _mm256_set_epi64x(not_a, not_h, not_h, -1);
+    const __m256i wrap_mirrored = _mm256_set_epi64x(not_h, not_a, not_a, -1);
+
+    __m256i gen_l = _mm256_set_epi64x(diag, diag, line, line);
+    __m256i gen_r = gen_l;
+    const __m256i empty = _mm256_set1_epi64x(static_cast<long long>(~occupied));
+    __m256i empty_l = _mm256_and_si256(empty, wrap);
+    __m256i empty_r = _mm256_and_si256(empty, wrap_mirrored);
+
+    gen_l = _mm256_or_si256(gen_l, _mm256_and_si256(empty_l, _mm256_sllv_epi64(gen_l, shift_1)));
+    gen_r = _mm256_or_si256(gen_r, _mm256_and_si256(empty_r, _mm256_srlv_epi64(gen_r, shift_1)));
+    empty_l = _mm256_and_si256(empty_l, _mm256_sllv_epi64(empty_l, shift_1));
+    empty_r = _mm256_and_si256(empty_r, _mm256_srlv_epi64(empty_r, shift_1));
+
+    gen_l = _mm256_or_si256(gen_l, _mm256_and_si256(empty_l, _mm256_sllv_epi64(gen_l, shift_2)));
+    gen_r = _mm256_or_si256(gen_r, _mm256_and_si256(empty_r, _mm256_srlv_epi64(gen_r, shift_2)));
+    empty_l = _mm256_and_si256(empty_l, _mm256_sllv_epi64(empty_l, shift_2));
+    empty_r = _mm256_and_si256(empty_r, _mm256_srlv_epi64(empty_r, shift_2));
+
+    gen_l = _mm256_or_si256(gen_l, _mm256_and_si256(empty_l, _mm256_sllv_epi64(gen_l, shift_4)));
+    gen_r = _mm256_or_si256(gen_r, _mm256_and_si256(empty_r, _mm256_srlv_epi64(gen_r, shift_4)));
+
+    const __m256i attacks =
+        _mm256_or_si256(_mm256_and_si256(_mm256_sllv_epi64(gen_l, shift_1), wrap),
+                        _mm256_and_si256(_mm256_srlv_epi64(gen_r, shift_1), wrap_mirrored));
+    const __m128i halves =
+        _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(halves) | _mm_extract_epi64(halves, 1));
+}
+#endif
+}  // namespace kogge_stone
+
+// every square attacked by a set of diagonal and straight sliders
+inline auto slider_attacks(const uint64_t diagonal, const uint64_t straight,
+                           const uint64_t occupied) -> uint64_t
+{
+#ifdef __AVX2__
+    return kogge_stone::slider_attacks_avx2(diagonal, straight, occupied);
+#else
+    return kogge_stone::slider_attacks_scalar(diagonal, straight, occupied);
+#endif
+}
+
+// all of a side's attacks computed from scratch for any occupancy. The engine itself asks
+// attackers_to and the stored attack sets instead, these fills are the independent answer the
+// [test] checks and benches compare them and gen_batch against
+template <side_t Side>
+auto full_side_attacks(const BitBoard &board, const uint64_t occupied) -> uint64_t
+{
+    using traits = side_traits<Side>;
+    return pawn_attacks<Side>(board[traits::pawn]) | knight_attacks(board[traits::knight]) |
+           move_masks::king_moves[__builtin_ctzll(board[traits::king])] |
+           slider_attacks(board[traits::bishop] | board[traits::queen],
+                          board[traits::rook] | board[traits::queen], occupied);
+}
@@ -0,0 +1,247 @@
+#include "batch_gen.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "attacks.h"
+#include "bitboard.h"
+#include "data.h"
+
+using namespace std;
+
+namespace
+{
+// The kernel is written against the same lane types as the fills it shares from attacks.h,
+// kogge_stone::scalar_lanes handles one position at a time and avx2_lanes four
+using kogge_stone::fill;
+using kogge_stone::scalar_lanes;
+using kogge_stone::shift;
+
+#ifdef __AVX2__
+struct avx2_lanes
+{
+    using reg = __m256i;
+    static constexpr size_t width = 4;
+
+    static auto load(const uint64_t *src) -> reg
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+    }
+    static void store(uint64_t *dst, const reg value)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), value);
+    }
+    static auto set1(const uint64_t value) -> reg
+    {
+        return _mm256_set1_epi64x(static_cast<long long>(value));
+    }
+    static auto and_(const reg a, const reg b) -> reg { return _mm256_and_si256(a, b); }
+    static auto or_(const reg a, const reg b) -> reg { return _mm256_or_si256(a, b); }
+    static auto andnot(const reg a, const reg b) -> reg { return _mm256_andnot_si256(a, b); }
+    template <int Shift>
+    static auto shl(const reg a) -> reg
+    {
+        return _mm256_slli_epi64(a, Shift);
+    }
+    template <int Shift>
+    static auto shr(const reg a) -> reg
+    {
+        return _mm256_srli_epi64(a, Shift);
+    }
+};
+#endif
+
+template <typename L>
+auto diagonal_fill(const typename L::reg gen, const typename L::reg empty) -> typename L::reg
+{
+    const auto not_h = L::set1(~masks::file_h);
+    const auto not_a = L::set1(~masks::file_a);
+    return L::or_(L::or_(fill<L, 9>(gen, empty, not_h), fill<L, 7>(gen, empty, not_a)),
+                  L::or_(fill<L, -7>(gen, empty, not_h), fill<L, -9>(gen, empty, not_a)));
+}
+
+template <typename L>
+auto straight_fill(const typename L::reg gen, const typename L::reg empty) -> typename L::reg
+{
+    const auto all = L::set1(~0ULL);
+    return L::or_(L::or_(fill<L, 8>(gen, empty, all), fill<L, -8>(gen, empty, all)),
+                  L::or_(fill<L, 1>(gen, empty, L::set1(~masks::file_h)),
+                         fill<L, -1>(gen, empty, L::set1(~masks::file_a))));
+}
+
+template <typename L>
+auto knight_fill(const typename L::reg knights) -> typename L::reg
+{
+    const auto one_file = L::or_(L::and_(L::template shl<1>(knights), L::set1(~masks::file_h)),
+                                 L::and_(L::template shr<1>(knights), L::set1(~masks::file_a)));
+    const auto two_files =
+        L::or_(L::and_(L::template shl<2>(knights), L::set1(~(masks::file_h | masks::file_g))),
+               L::and_(L::template shr<2>(knights), L::set1(~(masks::file_a | masks::file_b))));
+    return L::or_(L::or_(L::template shl<16>(one_file), L::template shr<16>(one_file)),
+                  L::or_(L::template shl<8>(two_files), L::template shr<8>(two_files)));
+}
+
+template <typename L>
+auto king_fill(const typename L::reg king) -> typename L::reg
+{
+    const auto sideways = L::or_(L::and_(L::template shl<1>(king), L::set1(~masks::file_h)),
+                                 L::and_(L::template shr<1>(king), L::set1(~masks::file_a)));
+    const auto row = L::or_(king, sideways);
+    return L::or_(sideways, L::or_(L::template shl<8>(row), L::template shr<8>(row)));
+}
+
+template <typename L, int AOffset, int HOffset>
+auto pawn_fill(const typename L::reg pawns) -> typename L::reg
+{
+    return L::or_(L::and_(shift<L, AOffset>(pawns), L::set1(~masks::file_h)),
+                  L::and_(shift<L, HOffset>(pawns), L::set1(~masks::file_a)));
+}
+
+// picks a where the lane mask is set and b elsewhere
+template <typename L>
+auto blend(const typename L::reg mask, const typename L::reg a, const typename L::reg b) ->
+    typename L::reg
+{
+    return L::or_(L::and_(mask, a), L::andnot(mask, b));
+}
+
+// processes the L::width positions starting at first
+template <typename L>
+void gen_group(const PositionBatch &batch, BatchResults &results, const size_t first)
+{
+    using reg = typename L::reg;
+    const reg white = L::load(&batch.white_to_move[first]);
+
+    // plain arrays as std::array drops the vector type's alignment attributes
+    reg own[batch_piece_kinds];    // NOLINT(cppcoreguidelines-avoid-c-arrays)
+    reg enemy[batch_piece_kinds];  // NOLINT(cppcoreguidelines-avoid-c-arrays)
+    reg own_pcs = L::set1(0);
+    reg enemy_pcs = L::set1(0);
+    for (size_t kind = 0; kind < batch_piece_kinds; kind++)
+    {
+        const reg white_pc = L::load(&batch.pieces[kind][first]);
+        const reg black_pc = L::load(&batch.pieces[kind + batch_piece_kinds][first]);
+        own[kind] = blend<L>(white, white_pc, black_pc);
+        enemy[kind] = blend<L>(white, black_pc, white_pc);
+        own_pcs = L::or_(own_pcs, own[kind]);
+        enemy_pcs = L::or_(enemy_pcs, enemy[kind]);
+    }
+    const auto pawn = static_cast<size_t>(piece_t::white_pawn);
+    const auto knight = static_cast<size_t>(piece_t::white_knight);
+    const auto bishop = static_cast<size_t>(piece_t::white_bishop);
+    const auto rook = static_cast<size_t>(piece_t::white_rook);
+    const auto queen = static_cast<size_t>(piece_t::white_queen);
+    const auto king = static_cast<size_t>(piece_t::white_king);
+
+    const reg occupied = L::or_(own_pcs, enemy_pcs);
+    const reg empty = L::andnot(occupied, L::set1(~0ULL));
+
+    // the king is taken off the board so it can't hide behind itself on a slider's ray
+    const reg empty_without_king = L::or_(empty, own[king]);
+    const reg enemy_pawn_attacks = blend<L>(white, pawn_fill<L, -7, -9>(enemy[pawn]),
+                                            pawn_fill<L, 9, 7>(enemy[pawn]));
+    const reg enemy_leaper_attacks = L::or_(
+        enemy_pawn_attacks, L::or_(knight_fill<L>(enemy[knight]), king_fill<L>(enemy[king])));
+    const reg attacked = L::or_(
+        enemy_leaper_attacks,
+        L::or_(diagonal_fill<L>(L::or_(enemy[bishop], enemy[queen]), empty_without_king),
+               straight_fill<L>(L::or_(enemy[rook], enemy[queen]), empty_without_king)));
+    L::store(&results.attacked[first], attacked);
+
+    const reg targetable = L::andnot(L::or_(own_pcs, enemy[king]), L::set1(~0ULL));
+    const reg captures = L::or_(L::andnot(enemy[king], enemy_pcs),
+                                L::load(&batch.en_passent[first]));
+
+    const reg white_pushes = L::and_(L::template shl<8>(own[pawn]), empty);
+    const reg black_pushes = L::and_(L::template shr<8>(own[pawn]), empty);
+    const reg pushes = blend<L>(
+        white,
+        L::or_(white_pushes,
+               L::and_(L::template shl<8>(L::and_(white_pushes, L::set1(masks::rank_3))), empty)),
+        L::or_(black_pushes,
+               L::and_(L::template shr<8>(L::and_(black_pushes, L::set1(masks::rank_6))), empty)));
+    const reg pawn_captures = L::and_(
+        blend<L>(white, pawn_fill<L, 9, 7>(own[pawn]), pawn_fill<L, -7, -9>(own[pawn])), captures);
+
+    L::store(&results.targets[pawn][first], L::or_(pushes, pawn_captures));
+    L::store(&results.targets[knight][first], L::and_(knight_fill<L>(own[knight]), targetable));
+    L::store(&results.targets[bishop][first],
+             L::and_(diagonal_fill<L>(own[bishop], empty), targetable));
+    L::store(&results.targets[rook][first],
+             L::and_(straight_fill<L>(own[rook], empty), targetable));
+    L::store(&results.targets[queen][first],
+             L::and_(L::or_(diagonal_fill<L>(own[queen], empty),
+                            straight_fill<L>(own[queen], empty)),
+                     targetable));
+    L::store(&results.targets[king][first],
+             L::andnot(attacked, L::and_(king_fill<L>(own[king]), targetable)));
+
+    array<uint64_t, L::width> checks{};
+    L::store(checks.data(), L::and_(attacked, own[king]));
+    for (size_t lane = 0; lane < L::width; lane++)
+    {
+        results.in_check[first + lane] = static_cast<uint8_t>(checks[lane] != 0);
+    }
+}
+}  // namespace
+
+void PositionBatch::push_back(const BitBoard &board)
+{
+    for (size_t piece = 0; piece < pieces.size(); piece++)
+    {
+        pieces[piece].push_back(board[static_cast<piece_t>(piece)]);
+    }
+    en_passent.push_back(board[piece_t::info] & (masks::rank_3 | masks::rank_6));
+    white_to_move.push_back(board.whites_turn() ? ~0ULL : 0);
+}
+
+void PositionBatch::reserve(const size_t count)
+{
+    for (auto &piece : pieces)
+    {
+        piece.reserve(count);
+    }
+    en_passent.reserve(count);
+    white_to_move.reserve(count);
+}
+
+void PositionBatch::clear()
+{
+    for (auto &piece : pieces)
+    {
+        piece.clear();
+    }
+    en_passent.clear();
+    white_to_move.clear();
+}
+
+void BatchResults::resize(const size_t count)
+{
+    for (auto &kind : targets)
+    {
+        kind.resize(count);
+    }
+    attacked.resize(count);
+    in_check.resize(count);
+}
+
+void gen_batch(const PositionBatch &batch, BatchResults &results)
+{
+    results.resize(batch.size());
+    size_t first = 0;
+#ifdef __AVX2__
+    for (; first + avx2_lanes::width <= batch.size(); first += avx2_lanes::width)
+    {
+        gen_group<avx2_lanes>(batch, results, first);
+    }
+#endif
+    for (; first < batch.size(); first++)
+    {
+        gen_group<scalar_lanes>(batch, results, first);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bitboard.h"
+
+// Number of positions gen_batch works on at once, one per 64 bit SIMD lane
+#ifdef __AVX2__
+inline constexpr size_t batch_lane_count = 4;
+#else
+inline constexpr size_t batch_lane_count = 1;
+#endif
+
+// Kinds of piece in a BatchResults::targets array, pawns to kings as in piece_t
+inline constexpr size_t batch_piece_kinds = 6;
+
+// Positions stored as a structure of arrays, every piece bitboard has its own array holding that
+// bitboard of every position, so one SIMD load fetches it for a whole group of positions
+struct PositionBatch
+{
+    // NOLINTBEGIN(misc-non-private-member-variables-in-classes)
+    std::array<std::vector<uint64_t>, 12> pieces;
+    std::vector<uint64_t> en_passent;
+    // all ones when white is to move, zero when black is, so it can be used as a lane mask
+    std::vector<uint64_t> white_to_move;
+    // NOLINTEND(misc-non-private-member-variables-in-classes)
+
+    void push_back(const BitBoard &board);
+    void reserve(size_t count);
+    void clear();
+    [[nodiscard]] auto size() const -> size_t { return white_to_move.size(); }
+};
+
+// Flat per position outputs of gen_batch, every array is indexed like the PositionBatch
+struct BatchResults
+{
+    // NOLINTBEGIN(misc-non-private-member-variables-in-classes)
+    // pseudo legal target squares of the side to move for each kind of piece. Kings leave out
+    // attacked squares and castling, nothing targets the enemy king
+    std::array<std::vector<uint64_t>, batch_piece_kinds> targets;
+    // squares the side not to move attacks, looking through the side to move's king
+    std::vector<uint64_t> attacked;
+    std::vector<uint8_t> in_check;
+    // NOLINTEND(misc-non-private-member-variables-in-classes)
+
+    void resize(size_t count);
+};
+
+void gen_batch(const PositionBatch &batch, BatchResults &results);
@@ -0,0 +1,541 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <print>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bitboard.h"
+#include "eval.h"
+#include "move.h"
+#include "move_gen.h"
+#include "nnue.h"
+#include "pawns.h"
+#include "perf_counters.h"
+#include "see.h"
+
+using namespace std;
+
+// ElwellBench [--format text|csv|json] [--filter substring] [--samples count] [--perf on|off]
+//
+// Times the engine's hot paths over a fixed position corpus. Every benchmark has a pinned number
+// of passes over the corpus per sample so runs on different builds do the same work, warm-up
+// samples are thrown away, and the spread of the rest is reported as percentiles of ns per op.
+// --perf on also counts the measured samples' cycles, instructions, cache and branch misses per op
+// where the system lets us read them
+
+namespace
+{
+constexpr int default_samples = 15;
+constexpr int warmup_samples = 3;
+
+// openings, middlegames and endgames with both sides to move, castling rights, en passent,
+// promotions and checks
+const array<string, 16> corpus_fens = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbqkb1r/pp2pppp/3p1n2/8/3NP3/8/PPP2PPP/RNBQKB1R w KQkq - 1 5",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1B1PPP/R2QKB1R w KQ - 0 8",
+    "2r2rk1/pp1bqppp/2n1pn2/3p4/1bPP4/2NBPN2/PPQ2PPP/R1B2RK1 b - - 4 11",
+    "r1b1k2r/ppppnppp/2n2q2/2b5/3NP3/2P1B3/PP3PPP/RN1QKB1R w KQkq - 0 7",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    "8/5pk1/6p1/8/3R4/6P1/5PKP/3r4 b - - 0 40",
+    "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1",
+    "8/8/8/3k4/8/8/2QK4/6r1 b - - 0 1",
+    "8/1P4k1/8/8/8/8/6p1/K7 w - - 0 1",
+    "4k3/8/8/8/8/8/4q3/4K3 w - - 0 1"};
+
+struct corpus_t
+{
+    vector<BitBoard> positions;
+    // the pseudo legal moves of each position
+    vector<vector<Move>> moves;
+    // built up front so the check and legality benchmarks don't time the generator's setup
+    vector<unique_ptr<MoveGen>> move_gens;
+    // the positions again with their network accumulators built
+    vector<BitBoard> nnue_positions;
+    // for the make_unmake benchmarks
+    UndoStack undo;
+    // the positions laid out for evaluate_batch, and somewhere for it to write to
+    eval_batch_t batch;
+    vector<int> evals;
+    size_t move_count = 0;
+};
+
+auto pseudo_legal_moves(const BitBoard &board) -> vector<Move>
+{
+    auto move_gen = MoveGen(board);
+    if (board.whites_turn())
+    {
+        move_gen.gen<side_t::white>();
+    }
+    else
+    {
+        move_gen.gen<side_t::black>();
+    }
+    return {move_gen.begin(), move_gen.end()};
+}
+
+// the corpus positions and all of their children
+auto build_corpus() -> corpus_t
+{
+    corpus_t corpus;
+    for (const string &fen : corpus_fens)
+    {
+        const auto root = BitBoard(fen);
+        for (const Move &move : pseudo_legal_moves(root))
+        {
+            BitBoard child = root;
+            child.apply_move(move);
+            corpus.positions.push_back(child);
+        }
+        corpus.positions.push_back(root);
+    }
+    for (const BitBoard &board : corpus.positions)
+    {
+        corpus.moves.push_back(pseudo_legal_moves(board));
+        corpus.move_count += corpus.moves.back().size();
+        corpus.move_gens.push_back(make_unique<MoveGen>(board));
+        corpus.nnue_positions.push_back(board);
+        corpus.nnue_positions.back().refresh_accumulators();
+        corpus.batch.push_back(board);
+    }
+    corpus.evals.resize(corpus.positions.size());
+    return corpus;
+}
+
+struct benchmark_t
+{
+    string name;
+    // pinned passes over the corpus per sample
+    int passes;
+    // operations in one pass
+    size_t ops;
+    // one pass, returning a value that depends on all of its work so it can't be optimised out
+    function<uint64_t()> pass;
+};
+
+struct result_t
+{
+    string name;
+    uint64_t ops;
+    // ns per operation of each sample, sorted
+    vector<double> samples;
+    uint64_t checksum;
+    // over all the measured samples, zero without --perf
+    PerfCounters::values_t counted;
+};
+
+// nearest rank percentile of sorted samples
+auto percentile(const vector<double> &sorted, int pct) -> double
+{
+    const size_t rank = (sorted.size() * static_cast<size_t>(pct) + 99) / 100;
+    return sorted.at(max<size_t>(rank, 1) - 1);
+}
+
+auto run_benchmark(const benchmark_t &bench, int samples, PerfCounters *counters) -> result_t
+{
+    result_t result{.name = bench.name,
+                    .ops = bench.ops * static_cast<uint64_t>(bench.passes),
+                    .samples = {},
+                    .checksum = 0,
+                    .counted = {}};
+    for (int sample = 0; sample < warmup_samples + samples; sample++)
+    {
+        if (counters != nullptr && sample == warmup_samples)
+        {
+            counters->start();
+        }
+        const auto start = chrono::steady_clock::now();
+        for (int pass = 0; pass < bench.passes; pass++)
+        {
+            result.checksum += bench.pass();
+        }
+        const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+        if (sample >= warmup_samples)
+        {
+            result.samples.push_back(elapsed.count() / static_cast<double>(result.ops));
+        }
+    }
+    if (counters != nullptr)
+    {
+        result.counted = counters->stop();
+    }
+    ranges::sort(result.samples);
+    return result;
+}
+
+auto make_benchmarks(corpus_t &corpus) -> vector<benchmark_t>
+{
+    vector<benchmark_t> benchmarks;
+    benchmarks.push_back({"fen_parse", 200, corpus_fens.size(), []()
+                          {
+                              uint64_t sum = 0;
+                              for (const string &fen : corpus_fens)
+                              {
+                                  sum += BitBoard(fen).hash();
+                              }
+                              return sum;
+                          }});
+    benchmarks.push_back({"apply_move", 20, corpus.move_count, [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (size_t idx = 0; idx < corpus.positions.size(); idx++)
+                              {
+                                  for (const Move &move : corpus.moves[idx])
+                                  {
+                                      corpus.positions[idx].apply_move(move);
+                                      sum += corpus.positions[idx].hash();
+                                      corpus.positions[idx].apply_move(move);
+                                  }
+                              }
+                              return sum;
+                          }});
+    benchmarks.push_back({"make_unmake", 20, corpus.move_count, [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (size_t idx = 0; idx < corpus.positions.size(); idx++)
+                              {
+                                  for (const Move &move : corpus.moves[idx])
+                                  {
+                                      corpus.positions[idx].make_move(move, corpus.undo);
+                                      sum += corpus.positions[idx].hash();
+                                      corpus.positions[idx].unmake_move(move, corpus.undo);
+                                  }
+                              }
+                              return sum;
+                          }});
+    benchmarks.push_back({"gen", 20, corpus.positions.size(), [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (const BitBoard &board : corpus.positions)
+                              {
+                                  auto move_gen = MoveGen(board);
+                                  if (board.whites_turn())
+                                  {
+                                      move_gen.gen<side_t::white>();
+                                  }
+                                  else
+                                  {
+                                      move_gen.gen<side_t::black>();
+                                  }
+                                  sum += static_cast<uint64_t>(move_gen.length());
+                              }
+                              return sum;
+                          }});
+    benchmarks.push_back({"is_king_in_check", 500, corpus.positions.size(), [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (size_t idx = 0; idx < corpus.positions.size(); idx++)
+                              {
+                                  const MoveGen &move_gen = *corpus.move_gens[idx];
+                                  sum += static_cast<uint64_t>(
+                                      corpus.positions[idx].whites_turn()
+                                          ? move_gen.is_king_in_check<side_t::white>()
+                                          : move_gen.is_king_in_check<side_t::black>());
+                              }
+                              return sum;
+                          }});
+    benchmarks.push_back({"is_legal", 20, corpus.move_count, [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (size_t idx = 0; idx < corpus.positions.size(); idx++)
+                              {
+                                  const BitBoard &board = corpus.positions[idx];
+                                  const MoveGen &move_gen = *corpus.move_gens[idx];
+                                  for (const Move &move : corpus.moves[idx])
+                                  {
+                                      sum += static_cast<uint64_t>(
+                                          board.whites_turn()
+                                              ? move_gen.is_legal<side_t::white>(move)
+                                              : move_gen.is_legal<side_t::black>(move));
+                                  }
+                              }
+                              return sum;
+                          }});
+    benchmarks.push_back({"attackers_to", 200, corpus.positions.size() * 2, [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (const BitBoard &board : corpus.positions)
+                              {
+                                  sum += board.attackers_to(
+                                      __builtin_ctzll(board[piece_t::white_king]));
+                                  sum += board.attackers_to(
+                                      __builtin_ctzll(board[piece_t::black_king]));
+                              }
+                              return sum;
+                          }});
+    benchmarks.push_back({"see", 20, corpus.move_count, [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (size_t idx = 0; idx < corpus.positions.size(); idx++)
+                              {
+                                  for (const Move &move : corpus.moves[idx])
+                                  {
+                                      sum += static_cast<uint64_t>(
+                                          see(corpus.positions[idx], move));
+                                  }
+                              }
+                              return sum;
+                          }});
+    benchmarks.push_back({"evaluate", 200, corpus.positions.size(), [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (const BitBoard &board : corpus.positions)
+                              {
+                                  sum += static_cast<uint64_t>(evaluate(board));
+                              }
+                              return sum;
+                          }});
+    // evaluate over the whole corpus at once, ops/s is positions a second
+    benchmarks.push_back({"evaluate_batch", 200, corpus.positions.size(), [&corpus]()
+                          {
+                              if (!evaluate_batch(corpus.batch, corpus.evals))
+                              {
+                                  return uint64_t{0};
+                              }
+                              uint64_t sum = 0;
+                              for (const int eval : corpus.evals)
+                              {
+                                  sum += static_cast<uint64_t>(eval);
+                              }
+                              return sum;
+                          }});
+    // the traced evaluation the eval command prints, next to evaluate to show what tracing
+    // costs when it's compiled in rather than what the untraced one pays for it
+    benchmarks.push_back({"evaluate_trace", 50, corpus.positions.size(), [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (const BitBoard &board : corpus.positions)
+                              {
+                                  sum += static_cast<uint64_t>(trace_evaluation(board).eval);
+                              }
+                              return sum;
+                          }});
+    // evaluate against a narrow window around a level score, which the corpus positions are
+    // mostly far enough outside of to skip the pawn structure
+    benchmarks.push_back({"evaluate_lazy", 200, corpus.positions.size(), [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (const BitBoard &board : corpus.positions)
+                              {
+                                  sum += static_cast<uint64_t>(evaluate(board, -25, 25));
+                              }
+                              return sum;
+                          }});
+    // the full board scan evaluate used to do at every leaf, for comparison with the incremental
+    // totals it reads now
+    benchmarks.push_back({"compute_psqt", 200, corpus.positions.size(), [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (const BitBoard &board : corpus.positions)
+                              {
+                                  sum += static_cast<uint64_t>(board.compute_psqt().midgame);
+                              }
+                              return sum;
+                          }});
+    // what evaluate would pay for the pawn structure at every leaf without the pawn table
+    benchmarks.push_back({"pawns_compute", 200, corpus.positions.size(), [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (const BitBoard &board : corpus.positions)
+                              {
+                                  sum += static_cast<uint64_t>(
+                                      pawns::compute(board[piece_t::white_pawn],
+                                                     board[piece_t::black_pawn])
+                                          .midgame);
+                              }
+                              return sum;
+                          }});
+    benchmarks.push_back({"evaluate_nnue", 200, corpus.nnue_positions.size(), [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              for (const BitBoard &board : corpus.nnue_positions)
+                              {
+                                  sum += static_cast<uint64_t>(nnue::evaluate(board));
+                              }
+                              return sum;
+                          }});
+    // make_unmake with the accumulators kept up to date as well
+    benchmarks.push_back({"make_unmake_nnue", 20, corpus.move_count, [&corpus]()
+                          {
+                              uint64_t sum = 0;
+                              nnue::enabled = true;
+                              for (size_t idx = 0; idx < corpus.nnue_positions.size(); idx++)
+                              {
+                                  for (const Move &move : corpus.moves[idx])
+                                  {
+                                      corpus.nnue_positions[idx].make_move(move, corpus.undo);
+                                      sum += corpus.nnue_positions[idx].hash();
+                                      corpus.nnue_positions[idx].unmake_move(move, corpus.undo);
+                                  }
+                              }
+                              nnue::enabled = false;
+                              return sum;
+                          }});
+    return benchmarks;
+}
+
+// IPC and each available counter per op, named for the csv and json output
+auto counter_columns(const result_t &result, const PerfCounters *counters)
+    -> vector<pair<string, double>>
+{
+    vector<pair<string, double>> columns;
+    if (counters == nullptr)
+    {
+        return columns;
+    }
+    if (counters->available(PerfCounters::cycles) &&
+        counters->available(PerfCounters::instructions) &&
+        result.counted[PerfCounters::cycles] > 0)
+    {
+        columns.emplace_back("ipc",
+                             static_cast<double>(result.counted[PerfCounters::instructions]) /
+                                 static_cast<double>(result.counted[PerfCounters::cycles]));
+    }
+    for (size_t counter = 0; counter < PerfCounters::counter_count; counter++)
+    {
+        if (counters->available(static_cast<PerfCounters::counter_t>(counter)))
+        {
+            columns.emplace_back(
+                string(PerfCounters::names[counter]) + "_per_op",
+                static_cast<double>(result.counted[counter]) / static_cast<double>(result.ops));
+        }
+    }
+    return columns;
+}
+
+void print_results(const vector<result_t> &results, string_view output,
+                   const PerfCounters *counters)
+{
+    if (output == "csv")
+    {
+        string header = "name,ops,samples,median_ns,p10_ns,p90_ns,min_ns,max_ns,checksum";
+        for (const auto &[column, value] : counter_columns(results.front(), counters))
+        {
+            header += "," + column;
+        }
+        println("{}", header);
+        for (const result_t &result : results)
+        {
+            string row = format("{},{},{},{:.3f},{:.3f},{:.3f},{:.3f},{:.3f},{:x}", result.name,
+                                result.ops, result.samples.size(), percentile(result.samples, 50),
+                                percentile(result.samples, 10), percentile(result.samples, 90),
+                                result.samples.front(), result.samples.back(), result.checksum);
+            for (const auto &[column, value] : counter_columns(result, counters))
+            {
+                row += format(",{:.4f}", value);
+            }
+            println("{}", row);
+        }
+    }
+    else if (output == "json")
+    {
+        println("[");
+        for (size_t idx = 0; idx < results.size(); idx++)
+        {
+            const result_t &result = results[idx];
+            string counter_fields;
+            for (const auto &[column, value] : counter_columns(result, counters))
+            {
+                counter_fields += format(", \"{}\": {:.4f}", column, value);
+            }
+            println("  {{\"name\": \"{}\", \"ops\": {}, \"samples\": {}, \"median_ns\": {:.3f}, "
+                    "\"p10_ns\": {:.3f}, \"p90_ns\": {:.3f}, \"min_ns\": {:.3f}, "
+                    "\"max_ns\": {:.3f}, \"checksum\": \"{:x}\"{}}}{}",
+                    result.name, result.ops, result.samples.size(),
+                    percentile(result.samples, 50), percentile(result.samples, 10),
+                    percentile(result.samples, 90), result.samples.front(),
+                    result.samples.back(), result.checksum, counter_fields,
+                    idx + 1 < results.size() ? "," : "");
+        }
+        println("]");
+    }
+    else
+    {
+        println("{:<18} {:>10} {:>12} {:>10} {:>10} {:>14}", "benchmark", "ops", "median ns",
+                "p10", "p90", "ops/s");
+        for (const result_t &result : results)
+        {
+            const double median = percentile(result.samples, 50);
+            println("{:<18} {:>10} {:>12.2f} {:>10.2f} {:>10.2f} {:>14.0f}", result.name,
+                    result.ops, median, percentile(result.samples, 10),
+                    percentile(result.samples, 90), median > 0 ? 1e9 / median : 0.0);
+            if (counters != nullptr && counters->available())
+            {
+                println("    {}", counters->summary(result.counted, result.ops, "op"));
+            }
+        }
+    }
+}
+}  // namespace
+
+auto main(int argc, char *argv[]) -> int
+{
+    const vector<string_view> args(argv + 1, argv + argc);
+    string_view format = "text";
+    string_view filter;
+    int samples = default_samples;
+    bool perf = false;
+    for (size_t idx = 0; idx + 1 < args.size(); idx += 2)
+    {
+        if (args[idx] == "--format")
+        {
+            format = args[idx + 1];
+        }
+        else if (args[idx] == "--filter")
+        {
+            filter = args[idx + 1];
+        }
+        else if (args[idx] == "--samples")
+        {
+            samples = max(stoi(string(args[idx + 1])), 1);
+        }
+        else if (args[idx] == "--perf")
+        {
+            perf = args[idx + 1] == "on";
+        }
+        else
+        {
+            println(stderr, "Unknown option: {}", args[idx]);
+            return 1;
+        }
+    }
+
+    unique_ptr<PerfCounters> counters = perf ? make_unique<PerfCounters>() : nullptr;
+    if (counters && !counters->error().empty())
+    {
+        println(stderr, "Hardware counters unavailable, {}", counters->error());
+    }
+    if (counters && !counters->available())
+    {
+        counters = nullptr;
+    }
+
+    corpus_t corpus = build_corpus();
+    vector<result_t> results;
+    for (const benchmark_t &bench : make_benchmarks(corpus))
+    {
+        if (bench.name.find(filter) != string::npos)
+        {
+            results.push_back(run_benchmark(bench, samples, counters.get()));
+        }
+    }
+    if (results.empty())
+    {
+        println(stderr, "No benchmark matches: {}", filter);
+        return 1;
+    }
+    print_results(results, format, counters.get());
+    return 0;
+}
@@ -2,13 +2,19 @@
 
 #include <array>
 #include <cassert>
+#include <cctype>
+#include <cstddef>
 #include <cstdint>
 #include <format>
 #include <string>
 #include <unordered_map>
+#include <utility>
 
+#include "attacks.h"
+#include "bitscan.h"
 #include "data.h"
 #include "move.h"
+#include "nnue.h"
 
 using namespace std;
 
@@ -32,7 +38,7 @@ BitBoard::BitBoard(const string &fen)
         {'p', piece_t::black_pawn}, {'n', piece_t::black_knight}, {'b', piece_t::black_bishop},
         {'r', piece_t::black_rook}, {'q', piece_t::black_queen},  {'k', piece_t::black_king},
     };
-    int idx = 0;
+    size_t idx = 0;
     for (const char piece : fen)
     {
         switch (piece)
@@ -51,6 +57,7 @@ BitBoard::BitBoard(const string &fen)
             case 'k':
                 board[static_cast<int>(piece_t_code_map[piece])] |=
                     1LL << (BitBoard::num_squares - 1 - sqr);
+                m_piece_on[BitBoard::num_squares - 1 - sqr] = piece_t_code_map[piece];
                 sqr++;
                 break;
             case '1':
@@ -111,6 +118,19 @@ BitBoard::BitBoard(const string &fen)
         const char rank = fen[idx++];
         board[static_cast<int>(piece_t::info)] |= sq_from_name(file, rank);
     }
+    else
+    {
+        idx++;
+    }
+
+    // halfmove clock is optional, plenty of test FENs stop after the en passent square
+    for (; idx < fen.size() && fen[idx] == ' '; idx++)
+    {
+    }
+    for (; idx < fen.size() && isdigit(fen[idx]) != 0; idx++)
+    {
+        m_halfmove_clock = static_cast<uint16_t>((m_halfmove_clock * 10) + (fen[idx] - '0'));
+    }
 
     board[static_cast<int>(piece_t::white_pcs)] = board[static_cast<int>(piece_t::white_pawn)] |
                                                   board[static_cast<int>(piece_t::white_bishop)] |
@@ -126,32 +146,345 @@ BitBoard::BitBoard(const string &fen)
                                                   board[static_cast<int>(piece_t::black_king)];
     board[static_cast<int>(piece_t::all_pcs)] =
         board[static_cast<int>(piece_t::white_pcs)] | board[static_cast<int>(piece_t::black_pcs)];
+
+    m_hash = compute_hash();
+    m_pawn_hash = compute_pawn_hash();
+    m_material_key = compute_material_key();
+    m_psqt = compute_psqt();
+    if (nnue::enabled)
+    {
+        refresh_accumulators();
+    }
+    update_attacks(~0ULL, ~0ULL, nullptr);
 }
 
-void BitBoard::apply_move(const Move &move)
+void BitBoard::toggle_pieces(const Move &move)
 {
-    assert(move.type != movType::BOOK_END);
+    // empty every square a piece leaves before filling the ones pieces arrive on, so a capture
+    // square ends up holding the capturer going forwards and the captured piece going backwards
+    const uint64_t left = (move.mov1 & board[static_cast<int>(move.pc1)]) |
+                          (move.mov2 & board[static_cast<int>(move.pc2)]) |
+                          (move.mov3 & board[static_cast<int>(move.pc3)]);
+    for (const auto bit : BitScan(left))
+    {
+        m_piece_on[__builtin_ctzll(bit)] = no_piece;
+    }
+    for (const auto bit : BitScan(move.mov1 & ~board[static_cast<int>(move.pc1)]))
+    {
+        m_piece_on[__builtin_ctzll(bit)] = move.pc1;
+    }
+    for (const auto bit : BitScan(move.mov2 & ~board[static_cast<int>(move.pc2)]))
+    {
+        m_piece_on[__builtin_ctzll(bit)] = move.pc2;
+    }
+    for (const auto bit : BitScan(move.mov3 & ~board[static_cast<int>(move.pc3)]))
+    {
+        m_piece_on[__builtin_ctzll(bit)] = move.pc3;
+    }
+
     board[static_cast<int>(move.pc1)] ^= move.mov1;
     board[static_cast<int>(move.pc2)] ^= move.mov2;
     board[static_cast<int>(move.pc3)] ^= move.mov3;
 
-    board[static_cast<int>(piece_t::info)] ^= (move.info | TURN_BIT);
-
-    // TODO: xor optimize
-    board[static_cast<int>(piece_t::white_pcs)] = board[static_cast<int>(piece_t::white_pawn)] |
-                                                  board[static_cast<int>(piece_t::white_bishop)] |
-                                                  board[static_cast<int>(piece_t::white_knight)] |
-                                                  board[static_cast<int>(piece_t::white_rook)] |
-                                                  board[static_cast<int>(piece_t::white_queen)] |
-                                                  board[static_cast<int>(piece_t::white_king)];
-    board[static_cast<int>(piece_t::black_pcs)] = board[static_cast<int>(piece_t::black_pawn)] |
-                                                  board[static_cast<int>(piece_t::black_bishop)] |
-                                                  board[static_cast<int>(piece_t::black_knight)] |
-                                                  board[static_cast<int>(piece_t::black_rook)] |
-                                                  board[static_cast<int>(piece_t::black_queen)] |
-                                                  board[static_cast<int>(piece_t::black_king)];
+    board[static_cast<int>(side_pcs(move.pc1))] ^= move.mov1;
+    board[static_cast<int>(side_pcs(move.pc2))] ^= move.mov2;
+    board[static_cast<int>(side_pcs(move.pc3))] ^= move.mov3;
     board[static_cast<int>(piece_t::all_pcs)] =
         board[static_cast<int>(piece_t::white_pcs)] | board[static_cast<int>(piece_t::black_pcs)];
+
+    if (nnue::enabled)
+    {
+        update_accumulator(move);
+    }
+}
+
+// Adds the features of the pieces toggle_pieces has just put down and removes those it has just
+// picked up, which undoes itself when unmake_move toggles the same move back. A king moving into
+// another bucket changes all of its side's features, so that side is rebuilt instead
+void BitBoard::update_accumulator(const Move &move)
+{
+    const array<pair<piece_t, uint64_t>, 3> toggled = {
+        {{move.pc1, move.mov1}, {move.pc2, move.mov2}, {move.pc3, move.mov3}}};
+    const array<uint64_t, 2> kings = {board[static_cast<int>(piece_t::white_king)],
+                                      board[static_cast<int>(piece_t::black_king)]};
+    for (size_t perspective = 0; perspective < 2; perspective++)
+    {
+        const uint8_t bucket =
+            nnue::king_bucket(perspective, __builtin_ctzll(kings.at(perspective)));
+        if (bucket != m_accumulator.buckets.at(perspective))
+        {
+            refresh_accumulator(perspective);
+            continue;
+        }
+        auto &values = m_accumulator.values.at(perspective);
+        for (const auto &[piece, squares] : toggled)
+        {
+            for (const auto bit : BitScan(squares))
+            {
+                const size_t feature = nnue::feature(perspective, static_cast<size_t>(piece),
+                                                     __builtin_ctzll(bit), bucket);
+                if ((board[static_cast<int>(piece)] & bit) != 0)
+                {
+                    nnue::add_feature(values, feature);
+                }
+                else
+                {
+                    nnue::sub_feature(values, feature);
+                }
+            }
+        }
+    }
+}
+
+void BitBoard::refresh_accumulator(const size_t perspective)
+{
+    const uint64_t king = board[static_cast<int>(perspective == 0 ? piece_t::white_king
+                                                                  : piece_t::black_king)];
+    const uint8_t bucket = nnue::king_bucket(perspective, __builtin_ctzll(king));
+    auto &values = m_accumulator.values.at(perspective);
+    m_accumulator.buckets.at(perspective) = bucket;
+    nnue::reset(values);
+    for (const auto bit : BitScan(board[static_cast<int>(piece_t::all_pcs)]))
+    {
+        const int sq = __builtin_ctzll(bit);
+        nnue::add_feature(values, nnue::feature(perspective,
+                                                static_cast<size_t>(m_piece_on[sq]), sq, bucket));
+    }
+}
+
+void BitBoard::refresh_accumulators()
+{
+    refresh_accumulator(0);
+    refresh_accumulator(1);
+}
+
+// Recomputes the attack sets of the touched squares and of every slider whose rays were affected.
+// A slider's attacks only change when a square its rays reach is emptied or filled, and such a
+// square is in its stored attack set both before and after the move. Returns the squares it
+// recomputed, saving their old attack sets to undo for unmake_move. The side maps are left to
+// attacks_by
+auto BitBoard::update_attacks(const uint64_t touched, const uint64_t occupancy_changed,
+                              UndoStack *undo) -> uint64_t
+{
+    const uint64_t occupied = board[static_cast<int>(piece_t::all_pcs)];
+    const uint64_t sliders =
+        operator[](piece_t::white_bishop) | operator[](piece_t::white_rook) |
+        operator[](piece_t::white_queen) | operator[](piece_t::black_bishop) |
+        operator[](piece_t::black_rook) | operator[](piece_t::black_queen);
+
+    uint64_t stale = touched;
+    for (const auto slider : BitScan(sliders & ~touched))
+    {
+        if ((m_attacks_from[__builtin_ctzll(slider)] & occupancy_changed) != 0)
+        {
+            stale |= slider;
+        }
+    }
+    for (const auto bit : BitScan(stale))
+    {
+        const int sq = __builtin_ctzll(bit);
+        if (undo != nullptr)
+        {
+            undo->m_saved_attacks.at(undo->m_saved_attacks_top++) = m_attacks_from[sq];
+        }
+        m_attacks_from[sq] = piece_attacks(m_piece_on[sq], bit, occupied);
+    }
+    return stale;
+}
+
+// leapers are cheap enough to fill in bulk, only the sliders need their stored attack sets
+template <side_t Side>
+auto BitBoard::side_attacks() const -> uint64_t
+{
+    using traits = side_traits<Side>;
+    uint64_t attacks = pawn_attacks<Side>(operator[](traits::pawn)) |
+                       knight_attacks(operator[](traits::knight)) |
+                       move_masks::king_moves[__builtin_ctzll(operator[](traits::king))];
+    for (const auto bit : BitScan(operator[](traits::bishop) | operator[](traits::rook) |
+                                  operator[](traits::queen)))
+    {
+        attacks |= m_attacks_from[__builtin_ctzll(bit)];
+    }
+    return attacks;
+}
+
+auto BitBoard::attacks_by(const side_t side) const -> uint64_t
+{
+    return side == side_t::white ? side_attacks<side_t::white>() : side_attacks<side_t::black>();
+}
+
+auto BitBoard::attackers_to(const int sq) const -> uint64_t
+{
+    return attackers_to(sq, operator[](piece_t::all_pcs));
+}
+
+auto BitBoard::attackers_to(const int sq, const uint64_t occupied) const -> uint64_t
+{
+    const uint64_t bit = 1ULL << sq;
+    const uint64_t diagonal = operator[](piece_t::white_bishop) | operator[](piece_t::white_queen) |
+                              operator[](piece_t::black_bishop) | operator[](piece_t::black_queen);
+    const uint64_t straight = operator[](piece_t::white_rook) | operator[](piece_t::white_queen) |
+                              operator[](piece_t::black_rook) | operator[](piece_t::black_queen);
+    const uint64_t knights = operator[](piece_t::white_knight) | operator[](piece_t::black_knight);
+    const uint64_t kings = operator[](piece_t::white_king) | operator[](piece_t::black_king);
+
+    return (bishop_attacks(bit, occupied) & diagonal) | (rook_attacks(bit, occupied) & straight) |
+           (move_masks::knight_moves[sq] & knights) | (move_masks::king_moves[sq] & kings) |
+           (pawn_attacks<side_t::black>(bit) & operator[](piece_t::white_pawn)) |
+           (pawn_attacks<side_t::white>(bit) & operator[](piece_t::black_pawn));
+}
+
+// Applying the same move twice restores the position, except for the halfmove clock
+void BitBoard::apply_move(const Move &move)
+{
+    assert(move.type != movType::BOOK_END);
+    const uint64_t occupied = operator[](piece_t::all_pcs);
+    toggle_pieces(move);
+    toggle_state(move);
+    update_attacks(move.mov1 | move.mov2 | move.mov3, occupied ^ operator[](piece_t::all_pcs),
+                   nullptr);
+}
+
+void BitBoard::toggle_state(const Move &move)
+{
+    const uint64_t info_xor = move.info | TURN_BIT;
+    board[static_cast<int>(piece_t::info)] ^= info_xor;
+
+    toggle_keys(move.pc1, move.mov1);
+    toggle_keys(move.pc2, move.mov2);
+    toggle_keys(move.pc3, move.mov3);
+    for (const auto bit : BitScan(info_xor))
+    {
+        m_hash ^= zobrist::info[__builtin_ctzll(bit)];
+    }
+}
+
+void BitBoard::toggle_keys(const piece_t piece, const uint64_t squares)
+{
+    const uint64_t pawn_mask =
+        piece == piece_t::white_pawn || piece == piece_t::black_pawn ? ~0ULL : 0;
+    for (const auto bit : BitScan(squares))
+    {
+        const uint64_t key = zobrist::pieces[static_cast<int>(piece)][__builtin_ctzll(bit)];
+        m_hash ^= key;
+        m_pawn_hash ^= key & pawn_mask;
+        toggle_psqt(piece, bit);
+    }
+}
+
+// adds piece's values on bit and counts it in the material key when toggle_pieces has just put it
+// there, and takes them off when it has just left
+void BitBoard::toggle_psqt(const piece_t piece, const uint64_t bit)
+{
+    const bool added = (board[static_cast<int>(piece)] & bit) != 0;
+    const int sign = added ? 1 : -1;
+    const pc_sq_table::packed_score_t score =
+        pc_sq_table::packed[static_cast<size_t>(piece)][__builtin_ctzll(bit)];
+    m_psqt.midgame += sign * score.midgame;
+    m_psqt.endgame += sign * score.endgame;
+    m_material_key = added ? m_material_key + material_unit(piece)
+                           : m_material_key - material_unit(piece);
+}
+
+void BitBoard::make_move(const Move &move, UndoStack &undo_stack)
+{
+    const bool is_capture = move.type == movType::CAPTURE || move.type == movType::CAPTURE_PROMOTE;
+    undo_t &undo = undo_stack.m_undo.at(undo_stack.m_ply);
+    undo_stack.m_ply++;
+    undo = {.info = board[static_cast<int>(piece_t::info)],
+            .hash = m_hash,
+            .pawn_hash = m_pawn_hash,
+            .material_key = m_material_key,
+            .psqt = m_psqt,
+            .stale_attacks = 0,
+            .saved_attacks_base = undo_stack.m_saved_attacks_top,
+            .halfmove_clock = m_halfmove_clock};
+
+    const uint64_t occupied = operator[](piece_t::all_pcs);
+    toggle_pieces(move);
+    toggle_state(move);
+    undo.stale_attacks = update_attacks(move.mov1 | move.mov2 | move.mov3,
+                                        occupied ^ operator[](piece_t::all_pcs), &undo_stack);
+
+    if (is_capture || move.pc1 == piece_t::white_pawn || move.pc1 == piece_t::black_pawn)
+    {
+        m_halfmove_clock = 0;
+    }
+    else
+    {
+        m_halfmove_clock++;
+    }
+}
+
+void BitBoard::unmake_move(const Move &move, UndoStack &undo_stack)
+{
+    assert(undo_stack.m_ply > 0);
+    const undo_t &undo = undo_stack.m_undo[--undo_stack.m_ply];
+    toggle_pieces(move);
+    board[static_cast<int>(piece_t::info)] = undo.info;
+    m_hash = undo.hash;
+    m_pawn_hash = undo.pawn_hash;
+    m_material_key = undo.material_key;
+    m_psqt = undo.psqt;
+    m_halfmove_clock = undo.halfmove_clock;
+
+    undo_stack.m_saved_attacks_top = undo.saved_attacks_base;
+    int saved_idx = undo.saved_attacks_base;
+    for (const auto bit : BitScan(undo.stale_attacks))
+    {
+        m_attacks_from[__builtin_ctzll(bit)] = undo_stack.m_saved_attacks[saved_idx++];
+    }
+}
+
+auto BitBoard::compute_hash() const -> uint64_t
+{
+    uint64_t hash = 0;
+    for (const auto bit : BitScan(board[static_cast<int>(piece_t::all_pcs)]))
+    {
+        const int sq = __builtin_ctzll(bit);
+        hash ^= zobrist::pieces[static_cast<int>(m_piece_on[sq])][sq];
+    }
+    for (const auto bit : BitScan(board[static_cast<int>(piece_t::info)]))
+    {
+        hash ^= zobrist::info[__builtin_ctzll(bit)];
+    }
+    return hash;
+}
+
+auto BitBoard::compute_pawn_hash() const -> uint64_t
+{
+    uint64_t hash = 0;
+    for (const piece_t pawn : {piece_t::white_pawn, piece_t::black_pawn})
+    {
+        for (const auto bit : BitScan(board[static_cast<int>(pawn)]))
+        {
+            hash ^= zobrist::pieces[static_cast<int>(pawn)][__builtin_ctzll(bit)];
+        }
+    }
+    return hash;
+}
+
+auto BitBoard::compute_material_key() const -> uint64_t
+{
+    uint64_t key = 0;
+    for (const auto bit : BitScan(board[static_cast<int>(piece_t::all_pcs)]))
+    {
+        key += material_unit(m_piece_on[__builtin_ctzll(bit)]);
+    }
+    return key;
+}
+
+auto BitBoard::compute_psqt() const -> psqt_t
+{
+    psqt_t psqt;
+    for (const auto bit : BitScan(board[static_cast<int>(piece_t::all_pcs)]))
+    {
+        const int sq = __builtin_ctzll(bit);
+        const auto piece = static_cast<size_t>(m_piece_on[sq]);
+        psqt.midgame += pc_sq_table::packed[piece][sq].midgame;
+        psqt.endgame += pc_sq_table::packed[piece][sq].endgame;
+    }
+    return psqt;
 }
 
 auto BitBoard::draw() const -> string
@@ -163,18 +496,13 @@ auto BitBoard::draw() const -> string
     for (int i = 0; i < BitBoard::num_squares; i++)
     {
         out += ((i % 8 + i / 8) % 2 == 0 ? light : dark);
-        int piece_found = 0;
-        for (const auto piece : piece_range::all())
+        const piece_t piece = m_piece_on[BitBoard::num_squares - 1 - i];
+        if (piece != no_piece)
         {
-            if ((operator[](piece) & (1ULL << (BitBoard::num_squares - 1 - i))) != 0)
-            {
-                out += piece_emojis[static_cast<int>(piece)];
-                out += " ";
-                piece_found = 1;
-                break;
-            }
+            out += piece_emojis[static_cast<int>(piece)];
+            out += " ";
         }
-        if (piece_found == 0)
+        else
         {
             out += "  ";
         }
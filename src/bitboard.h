@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <string>
 
+#include "nnue.h"
+
 struct Move;
 
 enum class side_t : uint8_t
@@ -37,6 +39,9 @@ enum class piece_t : uint8_t
     piece_count
 };
 
+// marks an empty square in the mailbox
+inline constexpr piece_t no_piece = piece_t::piece_count;
+
 inline auto operator-(const piece_t pc_a, const piece_t pc_b) -> int
 {
     return static_cast<int>(pc_a) - static_cast<int>(pc_b);
@@ -95,23 +100,127 @@ struct piece_range
     piece_t stop;
 };
 
+constexpr auto side_pcs(piece_t piece) -> piece_t
+{
+    return piece < piece_t::black_pawn ? piece_t::white_pcs : piece_t::black_pcs;
+}
+
+// White's piece square totals less black's
+struct psqt_t
+{
+    int midgame = 0;
+    int endgame = 0;
+};
+
+// The material key holds how many of each piece there are, four bits per piece_t from the white
+// pawns up, which is exact as long as no side promotes to a sixteenth piece of one kind
+constexpr auto material_unit(const piece_t piece) -> uint64_t
+{
+    return 1ULL << (4 * static_cast<int>(piece));
+}
+
+// Everything make_move changes that cannot be recovered by xor-ing the move back in
+struct undo_t
+{
+    uint64_t info;
+    uint64_t hash;
+    uint64_t pawn_hash;
+    uint64_t material_key;
+    psqt_t psqt;
+    // squares whose attack sets were overwritten, their old values start at saved_attacks_base
+    uint64_t stale_attacks;
+    int saved_attacks_base;
+    uint16_t halfmove_clock;
+};
+
+// What make_move needs to take its moves back again, kept by whoever is making the moves rather
+// than by the position, so copying a BitBoard only copies the position. Making more than max_ply
+// moves without taking them back throws std::out_of_range
+class UndoStack
+{
+   public:
+    static constexpr int max_ply = 128;
+    static constexpr int max_saved_attacks = max_ply * 32;
+
+    [[nodiscard]] auto ply() const -> int { return m_ply; }
+
+   private:
+    friend class BitBoard;
+    int m_ply = 0;
+    std::array<undo_t, max_ply> m_undo{};
+    int m_saved_attacks_top = 0;
+    std::array<uint64_t, max_saved_attacks> m_saved_attacks{};
+};
+
 class BitBoard
 {
+   public:
+    static constexpr int num_squares = 64;
+
    private:
     std::array<uint64_t, static_cast<int>(piece_t::piece_count)> board{};
+    std::array<piece_t, num_squares> m_piece_on = filled_mailbox();
+    std::array<uint64_t, num_squares> m_attacks_from{};
+    uint64_t m_hash = 0;
+    // the part of m_hash that comes from the pawns, which keys the pawn structure cache
+    uint64_t m_pawn_hash = 0;
+    uint64_t m_material_key = 0;
+    psqt_t m_psqt;
+    // only kept while nnue::enabled is set
+    nnue::accumulator_t m_accumulator{};
+    uint16_t m_halfmove_clock = 0;
     static constexpr uint64_t TURN_BIT = 0b10;
 
     static auto sq_from_name(char file, char rank) -> uint64_t;
+    static constexpr auto filled_mailbox() -> std::array<piece_t, num_squares>
+    {
+        std::array<piece_t, num_squares> mailbox{};
+        mailbox.fill(no_piece);
+        return mailbox;
+    }
+    void toggle_pieces(const Move &move);
+    void toggle_state(const Move &move);
+    void toggle_keys(piece_t piece, uint64_t squares);
+    void toggle_psqt(piece_t piece, uint64_t bit);
+    void update_accumulator(const Move &move);
+    void refresh_accumulator(size_t perspective);
+    // saves the attack sets it overwrites to undo when it isn't null
+    auto update_attacks(uint64_t touched, uint64_t occupancy_changed, UndoStack *undo)
+        -> uint64_t;
+    template <side_t Side>
+    [[nodiscard]] auto side_attacks() const -> uint64_t;
 
    public:
-    static constexpr int num_squares = 64;
-
     static auto start_position() -> BitBoard;
     BitBoard(const std::string &FEN);
     BitBoard();
     [[nodiscard]] auto draw() const -> std::string;
     auto operator[](piece_t piece) const -> uint64_t;
+    [[nodiscard]] auto piece_on(int sq) const -> piece_t { return m_piece_on[sq]; }
+    [[nodiscard]] auto attacks_from(int sq) const -> uint64_t { return m_attacks_from[sq]; }
+    // every square side attacks, put together from the stored slider sets when it is asked for
+    // since most positions are left before anything asks
+    [[nodiscard]] auto attacks_by(side_t side) const -> uint64_t;
+    [[nodiscard]] auto attackers_to(int sq) const -> uint64_t;
+    // attackers of both colours with slider rays blocked by occupied, callers mask out any pieces
+    // they have taken off occupied
+    [[nodiscard]] auto attackers_to(int sq, uint64_t occupied) const -> uint64_t;
     void apply_move(const Move &move);
+    void make_move(const Move &move, UndoStack &undo);
+    // takes back the last move made with undo, which has to be move
+    void unmake_move(const Move &move, UndoStack &undo);
+    [[nodiscard]] auto compute_hash() const -> uint64_t;
+    [[nodiscard]] auto hash() const -> uint64_t { return m_hash; }
+    [[nodiscard]] auto compute_pawn_hash() const -> uint64_t;
+    [[nodiscard]] auto pawn_hash() const -> uint64_t { return m_pawn_hash; }
+    [[nodiscard]] auto compute_material_key() const -> uint64_t;
+    [[nodiscard]] auto material_key() const -> uint64_t { return m_material_key; }
+    [[nodiscard]] auto compute_psqt() const -> psqt_t;
+    [[nodiscard]] auto psqt() const -> const psqt_t & { return m_psqt; }
+    [[nodiscard]] auto accumulator() const -> const nnue::accumulator_t & { return m_accumulator; }
+    // rebuilds both accumulators from scratch, for boards made before nnue::enabled was set
+    void refresh_accumulators();
+    [[nodiscard]] auto halfmove_clock() const -> int { return m_halfmove_clock; }
     [[nodiscard]] auto whites_turn() const -> bool
     {
         return (board[static_cast<int>(piece_t::info)] & TURN_BIT) != 0;
@@ -1,6 +1,8 @@
 #pragma once
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <utility>
 
 #include "bitboard.h"
 
@@ -267,6 +269,41 @@ inline constexpr std::array<int, BitBoard::num_squares> endgame<piece_t::black_k
     -12, 17,  14,  17,  17,  38,  23,  11,  -74, -35, -18, -18, -11, 15, 4,  -17,
 };
 
+// A piece's midgame and endgame values on a square side by side, negated for black so summing them
+// over the board gives white's totals less black's, which BitBoard keeps as pieces move
+struct packed_score_t
+{
+    int16_t midgame;
+    int16_t endgame;
+};
+
+template <piece_t Piece>
+constexpr void pack(std::array<std::array<packed_score_t, BitBoard::num_squares>, 12> &table)
+{
+    constexpr int sign = Piece < piece_t::black_pawn ? 1 : -1;
+    for (int sq = 0; sq < BitBoard::num_squares; sq++)
+    {
+        table[static_cast<size_t>(Piece)][sq] = {
+            .midgame = static_cast<int16_t>(sign * midgame<Piece>[sq]),
+            .endgame = static_cast<int16_t>(sign * endgame<Piece>[sq])};
+    }
+}
+
+inline constexpr auto packed = []
+{
+    std::array<std::array<packed_score_t, BitBoard::num_squares>, 12> table{};
+    [&]<size_t... Pieces>(std::index_sequence<Pieces...>)
+    { (pack<static_cast<piece_t>(Pieces)>(table), ...); }(std::make_index_sequence<12>{});
+    return table;
+}();
+
+inline constexpr auto phase = []
+{
+    return []<size_t... Pieces>(std::index_sequence<Pieces...>)
+    {
+        return std::array<int, 12>{mid_to_endgame_pc_val<static_cast<piece_t>(Pieces)>...};
+    }(std::make_index_sequence<12>{});
+}();
 }  // namespace pc_sq_table
 namespace masks
 {
@@ -385,6 +422,107 @@ static constexpr uint64_t black_queenside_king_move = white_queenside_king_move
 static constexpr uint64_t black_queenside_rook_move = white_queenside_rook_move << 56;
 }  // namespace castling
 
+// Everything the move generator needs to know about a side, so each generator is written once
+template <side_t Side>
+struct side_traits;
+
+template <>
+struct side_traits<side_t::white>
+{
+    static constexpr piece_t pawn = piece_t::white_pawn;
+    static constexpr piece_t knight = piece_t::white_knight;
+    static constexpr piece_t bishop = piece_t::white_bishop;
+    static constexpr piece_t rook = piece_t::white_rook;
+    static constexpr piece_t queen = piece_t::white_queen;
+    static constexpr piece_t king = piece_t::white_king;
+    static constexpr piece_t own_pcs = piece_t::white_pcs;
+
+    static constexpr piece_t enemy_pawn = piece_t::black_pawn;
+    static constexpr piece_t enemy_knight = piece_t::black_knight;
+    static constexpr piece_t enemy_bishop = piece_t::black_bishop;
+    static constexpr piece_t enemy_rook = piece_t::black_rook;
+    static constexpr piece_t enemy_queen = piece_t::black_queen;
+    static constexpr piece_t enemy_king = piece_t::black_king;
+    static constexpr piece_t enemy_pcs = piece_t::black_pcs;
+
+    static constexpr uint64_t back_rank = masks::rank_1;
+    static constexpr uint64_t double_push_rank = masks::rank_2;
+    static constexpr uint64_t en_passent_rank = masks::rank_6;
+    static constexpr uint64_t promotion_rank = masks::rank_8;
+
+    // shift offsets of a pawn capturing towards the a file and towards the h file
+    static constexpr int a_side_capture = 9;
+    static constexpr int h_side_capture = 7;
+
+    static constexpr auto forward(uint64_t squares, int offset) -> uint64_t
+    {
+        return squares << offset;
+    }
+    static constexpr auto backward(uint64_t squares, int offset) -> uint64_t
+    {
+        return squares >> offset;
+    }
+
+    static constexpr uint64_t kingside_right = castling::white_kingside_right;
+    static constexpr uint64_t queenside_right = castling::white_queenside_right;
+    static constexpr uint64_t kingside_space = castling::white_kingside_space;
+    static constexpr uint64_t queenside_space = castling::white_queenside_space;
+    static constexpr uint64_t kingside_attacked = castling::white_kingside_attacked;
+    static constexpr uint64_t queenside_attacked = castling::white_queenside_attacked;
+    static constexpr uint64_t kingside_king_move = castling::white_kingside_king_move;
+    static constexpr uint64_t kingside_rook_move = castling::white_kingside_rook_move;
+    static constexpr uint64_t queenside_king_move = castling::white_queenside_king_move;
+    static constexpr uint64_t queenside_rook_move = castling::white_queenside_rook_move;
+};
+
+template <>
+struct side_traits<side_t::black>
+{
+    static constexpr piece_t pawn = piece_t::black_pawn;
+    static constexpr piece_t knight = piece_t::black_knight;
+    static constexpr piece_t bishop = piece_t::black_bishop;
+    static constexpr piece_t rook = piece_t::black_rook;
+    static constexpr piece_t queen = piece_t::black_queen;
+    static constexpr piece_t king = piece_t::black_king;
+    static constexpr piece_t own_pcs = piece_t::black_pcs;
+
+    static constexpr piece_t enemy_pawn = piece_t::white_pawn;
+    static constexpr piece_t enemy_knight = piece_t::white_knight;
+    static constexpr piece_t enemy_bishop = piece_t::white_bishop;
+    static constexpr piece_t enemy_rook = piece_t::white_rook;
+    static constexpr piece_t enemy_queen = piece_t::white_queen;
+    static constexpr piece_t enemy_king = piece_t::white_king;
+    static constexpr piece_t enemy_pcs = piece_t::white_pcs;
+
+    static constexpr uint64_t back_rank = masks::rank_8;
+    static constexpr uint64_t double_push_rank = masks::rank_7;
+    static constexpr uint64_t en_passent_rank = masks::rank_3;
+    static constexpr uint64_t promotion_rank = masks::rank_1;
+
+    static constexpr int a_side_capture = 7;
+    static constexpr int h_side_capture = 9;
+
+    static constexpr auto forward(uint64_t squares, int offset) -> uint64_t
+    {
+        return squares >> offset;
+    }
+    static constexpr auto backward(uint64_t squares, int offset) -> uint64_t
+    {
+        return squares << offset;
+    }
+
+    static constexpr uint64_t kingside_right = castling::black_kingside_right;
+    static constexpr uint64_t queenside_right = castling::black_queenside_right;
+    static constexpr uint64_t kingside_space = castling::black_kingside_space;
+    static constexpr uint64_t queenside_space = castling::black_queenside_space;
+    static constexpr uint64_t kingside_attacked = castling::black_kingside_attacked;
+    static constexpr uint64_t queenside_attacked = castling::black_queenside_attacked;
+    static constexpr uint64_t kingside_king_move = castling::black_kingside_king_move;
+    static constexpr uint64_t kingside_rook_move = castling::black_kingside_rook_move;
+    static constexpr uint64_t queenside_king_move = castling::black_queenside_king_move;
+    static constexpr uint64_t queenside_rook_move = castling::black_queenside_rook_move;
+};
+
 namespace move_masks
 {
 // move gen
@@ -460,4 +598,40 @@ const std::array<uint8_t, 768> sliding_moves = {
     0x6,  0x5,  0x1b, 0x14, 0x2c, 0x50, 0xa0, 0x40, 0x2, 0x5,  0x1a, 0x14, 0x2c, 0x50, 0xa0, 0x40,
     0xe,  0xd,  0xb,  0x17, 0x28, 0x50, 0xa0, 0x40, 0x2, 0xd,  0xa,  0x16, 0x28, 0x50, 0xa0, 0x40,
     0x6,  0x5,  0xb,  0x14, 0x28, 0x50, 0xa0, 0x40, 0x2, 0x5,  0xa,  0x14, 0x28, 0x50, 0xa0, 0x40};
-}  // namespace move_masks
\ No newline at end of file
+}  // namespace move_masks
+namespace zobrist
+{
+constexpr auto splitmix64(uint64_t &state) -> uint64_t
+{
+    uint64_t key = (state += 0x9e3779b97f4a7c15);
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111eb;
+    return key ^ (key >> 31);
+}
+
+inline constexpr auto pieces = []
+{
+    std::array<std::array<uint64_t, BitBoard::num_squares>, 12> keys{};
+    uint64_t state = 0x456c77656c6c426fULL;
+    for (auto &piece_keys : keys)
+    {
+        for (auto &key : piece_keys)
+        {
+            key = splitmix64(state);
+        }
+    }
+    return keys;
+}();
+
+// one key per bit of the packed info word (turn, castling rights, en passent square)
+inline constexpr auto info = []
+{
+    std::array<uint64_t, BitBoard::num_squares> keys{};
+    uint64_t state = 0x696e666f6b657973ULL;
+    for (auto &key : keys)
+    {
+        key = splitmix64(state);
+    }
+    return keys;
+}();
+}  // namespace zobrist
@@ -0,0 +1,66 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bitboard.h"
+
+// A direct mapped cache of evaluation terms that only depend on part of the position, each slot
+// holding the entry of whichever position last probed it. Key picks out the part of the position
+// the entry depends on and Compute works the entry out from the board, leaving Entry::key to the
+// table
+template <typename Entry, size_t EntryCount, uint64_t (BitBoard::*Key)() const,
+          Entry (*Compute)(const BitBoard &)>
+class DirectTable
+{
+   public:
+    static constexpr size_t entry_count = EntryCount;
+    static_assert(std::has_single_bit(entry_count));
+
+    // every slot starts out holding initial, which has to be the right entry for its key
+    explicit DirectTable(const Entry &initial) : m_entries(entry_count, initial) {}
+
+    // board's entry, worked out and stored over whatever was in its slot when it isn't there
+    auto probe(const BitBoard &board) -> const Entry &
+    {
+        return probe((board.*Key)(), [&board] { return Compute(board); });
+    }
+    // the same for callers that have the key but not the board, compute() works the entry out
+    template <typename ComputeEntry>
+    auto probe(const uint64_t key, ComputeEntry compute) -> const Entry &
+    {
+        Entry &entry = m_entries[index(key)];
+        m_probes++;
+        if (entry.key == key)
+        {
+            m_hits++;
+            return entry;
+        }
+        entry = compute();
+        entry.key = key;
+        return entry;
+    }
+    // starts loading key's slot, for callers that know which keys they will probe next
+    void prefetch(const uint64_t key) const { __builtin_prefetch(&m_entries[index(key)]); }
+
+    [[nodiscard]] auto probes() const -> uint64_t { return m_probes; }
+    [[nodiscard]] auto hits() const -> uint64_t { return m_hits; }
+    void clear_counters()
+    {
+        m_probes = 0;
+        m_hits = 0;
+    }
+
+   private:
+    // keys like the material key keep most of their changes in the low bits, so all of the key is
+    // mixed into the index
+    static auto index(const uint64_t key) -> size_t
+    {
+        return (key * 0x9e3779b97f4a7c15ULL) >> (64 - std::countr_zero(entry_count));
+    }
+
+    std::vector<Entry> m_entries;
+    uint64_t m_probes = 0;
+    uint64_t m_hits = 0;
+};
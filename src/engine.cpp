@@ -1,8 +1,10 @@
 #include "engine.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <exception>
@@ -10,8 +12,10 @@
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <print>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <tuple>
 #include <utility>
@@ -19,28 +23,80 @@
 
 #include "bitboard.h"
 #include "data.h"
+#include "eval.h"
+#include "eval_cache.h"
+#include "material.h"
 #include "move.h"
 #include "move_gen.h"
+#include "nnue.h"
+#include "pawns.h"
+#include "testing.h"
+#include "trace.h"
 
 using namespace std;
 
+namespace
+{
+constexpr int default_bench_reps = 100;
+constexpr int default_perft_draft = 4;
+// every node is recomputed from scratch, so this walks a good deal shallower than perft
+constexpr int default_incremental_draft = 3;
+}  // namespace
+
+auto search_stats_t::operator+=(const search_stats_t& other) -> search_stats_t&
+{
+    nodes += other.nodes;
+    leaf_evals += other.leaf_evals;
+    cutoffs += other.cutoffs;
+    first_move_cutoffs += other.first_move_cutoffs;
+    illegal_moves += other.illegal_moves;
+    pawn_probes += other.pawn_probes;
+    pawn_hits += other.pawn_hits;
+    material_probes += other.material_probes;
+    material_hits += other.material_hits;
+    eval_probes += other.eval_probes;
+    eval_hits += other.eval_hits;
+    lazy_evals += other.lazy_evals;
+    lazy_exits += other.lazy_exits;
+    return *this;
+}
+
 void Engine::run(int depth)
 {
     unique_ptr<const result_t> p_result;
     atomic_bool b_stop = false;
+    UndoStack undo;
+    depth = min(depth, UndoStack::max_ply);
+    m_stats = {};
+    reset_thread_tables();
+    const auto start = chrono::steady_clock::now();
+    trace::begin("search", depth);
     if (m_board.whites_turn())
     {
-        tie(m_evaluation, p_result) = search<side_t::white>(
-            m_board, depth, numeric_limits<int>::min(), numeric_limits<int>::max(), b_stop);
+        tie(m_evaluation, p_result) =
+            search<side_t::white>(m_board, undo, depth, numeric_limits<int>::min(),
+                                  numeric_limits<int>::max(), b_stop, m_stats);
     }
     else
     {
-        tie(m_evaluation, p_result) = search<side_t::black>(
-            m_board, depth, numeric_limits<int>::min(), numeric_limits<int>::max(), b_stop);
+        tie(m_evaluation, p_result) =
+            search<side_t::black>(m_board, undo, depth, numeric_limits<int>::min(),
+                                  numeric_limits<int>::max(), b_stop, m_stats);
     }
+    trace::end("search", depth);
+    collect_table_stats(m_stats);
+    record_latency(search_time, start);
     if (p_result)
     {
+        if (m_print_info)
+        {
+            print_info(m_board, depth, m_evaluation, m_stats, chrono::steady_clock::now() - start,
+                       p_result.get());
+            print_stats(m_stats, depth);
+        }
+        const auto format_start = chrono::steady_clock::now();
         compute_results(p_result);
+        record_latency(result_format, format_start);
     }
     else
     {
@@ -53,27 +109,45 @@ void Engine::run(chrono::seconds timeout)
     atomic_bool b_stop = false;
 
     pair<int, unique_ptr<const result_t>> result = {0, nullptr};
+    m_stats = {};
+    const auto start = chrono::steady_clock::now();
+    trace::begin("timed search", timeout.count());
 
-    thread search_thread(
-        [this, &b_stop, &result]()
+    if (!m_search_thread.joinable())
+    {
+        m_search_thread = thread(&Engine::search_loop, this);
+    }
+    {
+        const lock_guard lock(m_search_mutex);
+        m_search_job = [this, &b_stop, &result]()
         {
             if (m_board.whites_turn())
             {
-                search_async<side_t::white>(result, m_board, b_stop);
+                search_async<side_t::white>(result, m_board, b_stop, m_stats, m_print_info);
             }
             else
             {
-                search_async<side_t::black>(result, m_board, b_stop);
+                search_async<side_t::black>(result, m_board, b_stop, m_stats, m_print_info);
             }
-        });
+        };
+    }
+    m_search_ready.notify_all();
 
     this_thread::sleep_for(timeout);
+    trace::instant("stop");
     b_stop = true;
-    search_thread.join();
+    {
+        unique_lock lock(m_search_mutex);
+        m_search_ready.wait(lock, [this] { return !m_search_job; });
+    }
+    trace::end("timed search", timeout.count());
+    record_latency(search_time, start);
 
     if (result.second)
     {
+        const auto format_start = chrono::steady_clock::now();
         compute_results(result.second);
+        record_latency(result_format, format_start);
     }
     else
     {
@@ -81,6 +155,37 @@ void Engine::run(chrono::seconds timeout)
     }
 }
 
+void Engine::search_loop()
+{
+    unique_lock lock(m_search_mutex);
+    for (;;)
+    {
+        m_search_ready.wait(lock, [this] { return m_quit || m_search_job; });
+        if (m_quit)
+        {
+            return;
+        }
+        lock.unlock();
+        m_search_job();
+        lock.lock();
+        m_search_job = nullptr;
+        m_search_ready.notify_all();
+    }
+}
+
+Engine::~Engine()
+{
+    if (m_search_thread.joinable())
+    {
+        {
+            const lock_guard lock(m_search_mutex);
+            m_quit = true;
+        }
+        m_search_ready.notify_all();
+        m_search_thread.join();
+    }
+}
+
 void Engine::compute_results(const unique_ptr<const result_t>& p_result)
 {
     m_uci = move_to_uci(p_result->best_move);
@@ -96,19 +201,75 @@ void Engine::load(const string& fen) { m_board = BitBoard(fen); }
 
 void Engine::fill_pv(const unique_ptr<const result_t>& p_result)
 {
-    m_pv.clear();
-    const result_t* p_node = p_result.get();
-    BitBoard board = m_board;
-    while (p_node != nullptr)
+    m_pv = pv_of(p_result.get(), m_board);
+}
+
+auto Engine::pv_of(const result_t* p_result, BitBoard board) -> vector<string>
+{
+    vector<string> pv;
+    for (const result_t* p_node = p_result; p_node != nullptr; p_node = p_node->next.get())
     {
-        m_pv.push_back(move_to_uci(p_node->best_move, board));
+        pv.push_back(move_to_uci(p_node->best_move, board));
         board.apply_move(p_node->best_move);
-        if (!p_node->next)
-        {
-            break;
-        }
-        p_node = p_node->next.get();
     }
+    return pv;
+}
+
+// uci info line for a finished iteration, eval is from white's point of view
+void Engine::print_info(const BitBoard& board, int depth, int eval, const search_stats_t& stats,
+                        chrono::duration<double> elapsed, const result_t* p_result)
+{
+    string pv;
+    for (const string& move : pv_of(p_result, board))
+    {
+        pv += " " + move;
+    }
+    const int score = board.whites_turn() ? eval : -eval;
+    println("info depth {} score cp {} nodes {} nps {:.0f} time {:.0f} pv{}", depth, score,
+            stats.nodes, static_cast<double>(stats.nodes) / max(elapsed.count(), 1e-9),
+            elapsed.count() * 1000, pv);
+}
+
+// the counters only kept with ELWELLBOT_SEARCH_STATS, the effective branching factor is the one
+// that would give the nodes searched over depth plies
+void Engine::print_stats(const search_stats_t& stats, int depth)
+{
+    if constexpr (search_stats_enabled)
+    {
+        const double ebf =
+            depth > 0 ? pow(static_cast<double>(stats.nodes), 1.0 / static_cast<double>(depth))
+                      : 0.0;
+        println(
+            "info string stats nodes {} leaf_evals {} cutoffs {} first_move_cutoffs {:.1f}% "
+            "ebf {:.2f} illegal_moves {} pawn_hits {:.1f}% material_hits {:.1f}% "
+            "eval_hits {:.1f}% lazy_exits {:.1f}%",
+            stats.nodes, stats.leaf_evals, stats.cutoffs,
+            hit_rate(stats.first_move_cutoffs, stats.cutoffs), ebf, stats.illegal_moves,
+            hit_rate(stats.pawn_hits, stats.pawn_probes),
+            hit_rate(stats.material_hits, stats.material_probes),
+            hit_rate(stats.eval_hits, stats.eval_probes),
+            hit_rate(stats.lazy_exits, stats.lazy_evals));
+    }
+}
+
+void Engine::reset_thread_tables()
+{
+    pawns::table().clear_counters();
+    material::table().clear_counters();
+    eval_cache::table().clear_counters();
+    lazy_counters() = {};
+}
+
+void Engine::collect_table_stats(search_stats_t& stats)
+{
+    stats.pawn_probes = pawns::table().probes();
+    stats.pawn_hits = pawns::table().hits();
+    stats.material_probes = material::table().probes();
+    stats.material_hits = material::table().hits();
+    stats.eval_probes = eval_cache::table().probes();
+    stats.eval_hits = eval_cache::table().hits();
+    stats.lazy_evals = lazy_counters().evals;
+    stats.lazy_exits = lazy_counters().exits;
 }
 
 auto Engine::move_to_uci(const Move& mov, const BitBoard& board) -> string
@@ -222,7 +383,6 @@ auto Engine::move_to_algebraic(const Move& move, BitBoard board) -> string
             out += "+";
         }
     }
-    board.apply_move(move);
     return out;
 }
 
@@ -328,6 +488,286 @@ auto Engine::handle_go(const std::string& type_str, const std::string& value_str
     return true;
 }
 
+auto Engine::handle_test(const vector<string>& tokens) -> bool
+{
+    if (tokens.size() < 2)
+    {
+        return false;
+    }
+    // up to two numeric arguments, zero when left out
+    array<int, 2> values{};
+    for (size_t idx = 2; idx < min(tokens.size(), values.size() + 2); idx++)
+    {
+        try
+        {
+            values.at(idx - 2) = stoi(tokens.at(idx));
+        }
+        catch (exception& e)
+        {
+            println("Failed at stoi: [{}]", tokens.at(idx));
+            return false;
+        }
+    }
+    const int value = values[0];
+
+    if (tokens.at(1) == "perft")
+    {
+        run_perft_test(value > 0 ? value : default_perft_draft);
+    }
+    else if (tokens.at(1) == "perftmt")
+    {
+        const auto hardware_threads = static_cast<int>(thread::hardware_concurrency());
+        return run_parallel_perft_test(value > 0 ? value : default_perft_draft,
+                                       values[1] > 0 ? values[1] : max(hardware_threads, 1));
+    }
+    else if (tokens.at(1) == "makeunmake")
+    {
+        run_make_unmake_bench(value > 0 ? value : default_bench_reps);
+    }
+    else if (tokens.at(1) == "sliderfill")
+    {
+        return run_slider_fill_bench(value > 0 ? value : default_bench_reps);
+    }
+    else if (tokens.at(1) == "batchgen")
+    {
+        return run_batch_gen_bench(value > 0 ? value : default_bench_reps);
+    }
+    else if (tokens.at(1) == "see")
+    {
+        return run_see_test(value > 0 ? value : default_bench_reps);
+    }
+    else if (tokens.at(1) == "incremental")
+    {
+        return run_incremental_test(value > 0 ? value : default_incremental_draft);
+    }
+    else if (tokens.at(1) == "batch")
+    {
+        return run_batch_test();
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// [bench] followed by an optional depth and [perf] for the hardware counters
+auto Engine::handle_bench(const vector<string>& tokens) -> bool
+{
+    int depth = default_search_bench_depth;
+    const bool perf = tokens.back() == "perf";
+    if (tokens.size() > (perf ? 2U : 1U))
+    {
+        try
+        {
+            depth = stoi(tokens.at(1));
+        }
+        catch (exception& e)
+        {
+            println("Failed at stoi: [{}]", tokens.at(1));
+            return false;
+        }
+    }
+    run_search_bench(depth, perf);
+    return true;
+}
+
+// [trace] [clear] drops the events recorded so far, [trace] [file] writes them to file
+auto Engine::handle_trace(const vector<string>& tokens) -> bool
+{
+    if (!trace::enabled)
+    {
+        println("Tracing is not built in, configure with ELWELLBOT_TRACE");
+        return false;
+    }
+    if (tokens.size() < 2)
+    {
+        return false;
+    }
+    if (tokens.at(1) == "clear")
+    {
+        trace::clear();
+        return true;
+    }
+    return trace::dump(tokens.at(1));
+}
+
+// [stats] prints how long each part of answering commands has taken, [stats] [reset] clears it
+auto Engine::handle_stats(const vector<string>& tokens) -> bool
+{
+    if (tokens.size() > 1)
+    {
+        if (tokens.at(1) != "reset")
+        {
+            return false;
+        }
+        for (LatencyHistogram& histogram : m_latency)
+        {
+            histogram.clear();
+        }
+        return true;
+    }
+    const auto micros = [](chrono::nanoseconds elapsed)
+    { return chrono::duration<double, micro>(elapsed).count(); };
+    println("{:<16} {:>8} {:>12} {:>12} {:>12} {:>12}", "stage", "count", "mean us", "p50 us",
+            "p99 us", "max us");
+    for (size_t stage = 0; stage < latency_stage_count; stage++)
+    {
+        const LatencyHistogram& histogram = m_latency.at(stage);
+        println("{:<16} {:>8} {:>12.1f} {:>12.1f} {:>12.1f} {:>12.1f}",
+                latency_stage_names.at(stage), histogram.count(), micros(histogram.mean()),
+                micros(histogram.percentile(50)), micros(histogram.percentile(99)),
+                micros(histogram.max()));
+    }
+    return true;
+}
+
+// [debug] [on|off] switches echoing received commands to cerr
+auto Engine::handle_debug(const vector<string>& tokens) -> bool
+{
+    if (tokens.size() < 2 || (tokens.at(1) != "on" && tokens.at(1) != "off"))
+    {
+        return false;
+    }
+    m_debug = tokens.at(1) == "on";
+    return true;
+}
+
+// [info] [on|off] switches printing an info line after each search iteration, off by default so
+// that every go answers with exactly one line
+auto Engine::handle_info(const vector<string>& tokens) -> bool
+{
+    if (tokens.size() < 2 || (tokens.at(1) != "on" && tokens.at(1) != "off"))
+    {
+        return false;
+    }
+    m_print_info = tokens.at(1) == "on";
+    return true;
+}
+
+// [nnue] [on|off] switches between the network and the piece square evaluation, optionally
+// followed by a network file to map in place of the current one
+auto Engine::handle_nnue(const vector<string>& tokens) -> bool
+{
+    if (tokens.size() < 2 || (tokens.at(1) != "on" && tokens.at(1) != "off"))
+    {
+        return false;
+    }
+    if (tokens.size() > 2 && !nnue::load(tokens.at(2)))
+    {
+        println("Failed to load network: [{}]", tokens.at(2));
+        return false;
+    }
+    nnue::enabled = tokens.at(1) == "on";
+    eval_cache::invalidate();
+    if (nnue::enabled)
+    {
+        m_board.refresh_accumulators();
+    }
+    return true;
+}
+
+// [evalcache] [entries] sets how many evaluations each search thread caches, 0 for none
+auto Engine::handle_evalcache(const vector<string>& tokens) -> bool
+{
+    if (tokens.size() < 2)
+    {
+        return false;
+    }
+    try
+    {
+        eval_cache::resize(stoul(tokens.at(1)));
+    }
+    catch (exception& e)
+    {
+        println("Failed at stoul: [{}]", tokens.at(1));
+        return false;
+    }
+    return true;
+}
+
+// [eval] prints the terms of the static evaluation from white's side, of the last position or
+// of one given as [eval] [FEN|startpos]
+auto Engine::handle_eval(const vector<string>& tokens) -> bool
+{
+    if (tokens.size() > 1 && !handle_position(tokens.at(1)))
+    {
+        return false;
+    }
+    constexpr array<string_view, 6> piece_names = {"pawns",  "knights", "bishops",
+                                                   "rooks",  "queens",  "king"};
+    const eval_trace_t trace = trace_evaluation(m_board);
+    // neither the network nor a known ending is made of the terms below
+    if (trace.source == "network" || trace.source == "known ending")
+    {
+        println("source {} eval {}", trace.source, trace.eval);
+        return true;
+    }
+    println("{:<14} {:>8} {:>8} {:>8} {:>8} {:>8} {:>8}", "term", "white mg", "white eg",
+            "black mg", "black eg", "mg", "eg");
+    for (size_t kind = 0; kind < piece_names.size(); kind++)
+    {
+        const psqt_t& white = trace.pieces.at(kind);
+        const psqt_t& black = trace.pieces.at(kind + piece_names.size());
+        println("{:<14} {:>8} {:>8} {:>8} {:>8} {:>8} {:>8}", piece_names.at(kind),
+                white.midgame, white.endgame, -black.midgame, -black.endgame,
+                white.midgame + black.midgame, white.endgame + black.endgame);
+    }
+    const auto print_term = [](string_view name, const psqt_t& term)
+    { println("{:<14} {:>44} {:>8}", name, term.midgame, term.endgame); };
+    print_term("imbalance", trace.imbalance);
+    print_term("pawn structure", trace.pawns);
+    print_term("king shields", {.midgame = trace.king_shields, .endgame = 0});
+    print_term("total", trace.total);
+    println("source {} phase {} endgame scale {}/{} eval {}", trace.source, trace.phase,
+            trace.scale, material::scale_normal, trace.eval);
+    return true;
+}
+
+void Engine::record_latency(latency_stage_t stage, chrono::steady_clock::time_point start)
+{
+    m_latency.at(stage).record(chrono::steady_clock::now() - start);
+}
+
+// [perft|divide] [depth] followed by an optional position and [stats] for the move breakdown
+auto Engine::handle_perft(const vector<string>& tokens) -> bool
+{
+    if (tokens.size() < 2)
+    {
+        return false;
+    }
+    int depth = 0;
+    try
+    {
+        depth = stoi(tokens.at(1));
+    }
+    catch (exception& e)
+    {
+        println("Failed at stoi: [{}]", tokens.at(1));
+        return false;
+    }
+    // deeper than the undo stack would run out of room to take the moves back
+    if (depth < 0 || depth > UndoStack::max_ply)
+    {
+        println("Usage: [perft|divide] [depth 0-{}] [FEN|startpos] [stats]", UndoStack::max_ply);
+        return false;
+    }
+    bool breakdown = false;
+    for (size_t idx = 2; idx < tokens.size(); idx++)
+    {
+        if (tokens.at(idx) == "stats")
+        {
+            breakdown = true;
+        }
+        else if (!handle_position(tokens.at(idx)))
+        {
+            return false;
+        }
+    }
+    run_perft(m_board, depth, tokens.at(0) == "divide", breakdown);
+    return true;
+}
+
 void Engine::uci_loop()
 {
     string line;
@@ -340,20 +780,25 @@ void Engine::uci_loop()
             continue;
         }
 
+        const auto parse_start = chrono::steady_clock::now();
         auto tokens = split_into_tokens(line);
+        record_latency(input_parse, parse_start);
 
-        // Debug output - but check size first!
-        cerr << "Received " << tokens.size() << " tokens: ";
-        for (const auto& token : tokens)
+        if (m_debug)
         {
-            cerr << "[" << token << "] ";
+            cerr << "Received " << tokens.size() << " tokens: ";
+            for (const auto& token : tokens)
+            {
+                cerr << "[" << token << "] ";
+            }
+            cerr << "\n";
         }
-        cerr << "\n";
 
         if (tokens.empty())
         {
             continue;
         }
+        trace::instant(tokens.at(0));
 
         if (tokens.at(0) == "ready")
         {
@@ -367,17 +812,93 @@ void Engine::uci_loop()
                 continue;
             }
 
+            const auto position_start = chrono::steady_clock::now();
             if (!handle_position(tokens.at(1)))
             {
                 cout << "Failed to set position" << "\n";
                 continue;
             }
+            record_latency(position_setup, position_start);
             if (!handle_go(tokens.at(2), tokens.at(3)))
             {
                 cout << "Failed to get best move" << "\n";
                 continue;
             }
+            const auto flush_start = chrono::steady_clock::now();
             cout << "bestmove " << get_uci() << "\n";
+            cout.flush();
+            record_latency(output_flush, flush_start);
+            trace::instant("bestmove");
+        }
+        else if (tokens.at(0) == "perft" || tokens.at(0) == "divide")
+        {
+            if (!handle_perft(tokens))
+            {
+                cout << "Failed to run perft" << "\n";
+            }
+        }
+        else if (tokens.at(0) == "bench")
+        {
+            if (!handle_bench(tokens))
+            {
+                cout << "Failed to run bench" << "\n";
+            }
+        }
+        else if (tokens.at(0) == "stats")
+        {
+            if (!handle_stats(tokens))
+            {
+                cout << "Failed to show stats" << "\n";
+            }
+        }
+        else if (tokens.at(0) == "debug")
+        {
+            if (!handle_debug(tokens))
+            {
+                cout << "Failed to set debug" << "\n";
+            }
+        }
+        else if (tokens.at(0) == "info")
+        {
+            if (!handle_info(tokens))
+            {
+                cout << "Failed to set info" << "\n";
+            }
+        }
+        else if (tokens.at(0) == "nnue")
+        {
+            if (!handle_nnue(tokens))
+            {
+                cout << "Failed to set nnue" << "\n";
+            }
+        }
+        else if (tokens.at(0) == "eval")
+        {
+            if (!handle_eval(tokens))
+            {
+                cout << "Failed to evaluate position" << "\n";
+            }
+        }
+        else if (tokens.at(0) == "evalcache")
+        {
+            if (!handle_evalcache(tokens))
+            {
+                cout << "Failed to set evalcache" << "\n";
+            }
+        }
+        else if (tokens.at(0) == "trace")
+        {
+            if (!handle_trace(tokens))
+            {
+                cout << "Failed to write trace" << "\n";
+            }
+        }
+        else if (tokens.at(0) == "test")
+        {
+            if (!handle_test(tokens))
+            {
+                cout << "Failed to run test" << "\n";
+            }
         }
         else
         {
@@ -1,17 +1,80 @@
 #pragma once
+#include <array>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 #include "bitboard.h"
+#include "latency.h"
 #include "move.h"
 
+// The node count is always kept as bench and nps need it, the rest of search_stats_t is only
+// counted in builds configured with ELWELLBOT_SEARCH_STATS
+#ifdef ELWELLBOT_SEARCH_STATS
+inline constexpr bool search_stats_enabled = true;
+#else
+inline constexpr bool search_stats_enabled = false;
+#endif
+
+// counters kept by a search thread
+struct search_stats_t
+{
+    uint64_t nodes = 0;
+    uint64_t leaf_evals = 0;
+    // nodes whose search stopped early on a cutoff, and those where the first move did it
+    uint64_t cutoffs = 0;
+    uint64_t first_move_cutoffs = 0;
+    // pseudo legal moves thrown away for leaving the king in check
+    uint64_t illegal_moves = 0;
+    // pawn structure lookups by the searching thread and how many found their entry, counted
+    // whether or not the search statistics are built in
+    uint64_t pawn_probes = 0;
+    uint64_t pawn_hits = 0;
+    // the same for the material table
+    uint64_t material_probes = 0;
+    uint64_t material_hits = 0;
+    // and for the evaluation cache
+    uint64_t eval_probes = 0;
+    uint64_t eval_hits = 0;
+    // leaf evaluations given a window and how many of them the piece square and material score
+    // settled on its own
+    uint64_t lazy_evals = 0;
+    uint64_t lazy_exits = 0;
+
+    auto operator+=(const search_stats_t &other) -> search_stats_t &;
+};
+
+// hits as a percentage of probes, zero when nothing was probed
+inline auto hit_rate(const uint64_t hits, const uint64_t probes) -> double
+{
+    return probes > 0 ? 100.0 * static_cast<double>(hits) / static_cast<double>(probes) : 0.0;
+}
+
 struct result_t
 {
     Move best_move;
     std::unique_ptr<const result_t> next;
 };
 
+// the parts of answering a command that the stats command times
+enum latency_stage_t : uint8_t
+{
+    input_parse,
+    position_setup,
+    search_time,
+    result_format,
+    output_flush,
+    latency_stage_count
+};
+
+inline constexpr std::array<std::string_view, latency_stage_count> latency_stage_names = {
+    "input parse", "position setup", "search", "result format", "output flush"};
+
 class Engine
 {
    private:
@@ -20,17 +83,45 @@ class Engine
     std::string m_algebraic;
     std::vector<std::string> m_pv;
     int m_evaluation;
+    search_stats_t m_stats;
+    // print info lines while searching, switched on with the info command
+    bool m_print_info = false;
+    // echo every command received to cerr
+    bool m_debug = false;
+    std::array<LatencyHistogram, latency_stage_count> m_latency;
+    // Timed searches run on one thread kept for the engine's lifetime, so the per thread pawn,
+    // material and evaluation caches stay warm from one move to the next. It is started by the
+    // first timed search and waits on m_search_ready for the next job in between
+    std::thread m_search_thread;
+    std::mutex m_search_mutex;
+    std::condition_variable m_search_ready;
+    // the search for m_search_thread to run, empty once it has finished
+    std::function<void()> m_search_job;
+    bool m_quit = false;
+
+    void search_loop();
 
     template <side_t Side>
-    static auto search(BitBoard &board, int iter, int alpha, int beta, std::atomic_bool &b_stop)
+    static auto search(BitBoard &board, UndoStack &undo, int iter, int alpha, int beta,
+                       std::atomic_bool &b_stop, search_stats_t &stats)
         -> std::pair<int, std::unique_ptr<result_t>>;
 
     template <side_t Side>
     static void search_async(std::pair<int, std::unique_ptr<const result_t>> &result,
-                             BitBoard board, std::atomic_bool &b_stop);
+                             BitBoard board, std::atomic_bool &b_stop, search_stats_t &stats,
+                             bool report);
+
+    static void print_info(const BitBoard &board, int depth, int eval,
+                           const search_stats_t &stats, std::chrono::duration<double> elapsed,
+                           const result_t *p_result);
+    static void print_stats(const search_stats_t &stats, int depth);
+    // zeroes the calling thread's cache counters ahead of a search
+    static void reset_thread_tables();
+    // copies the calling thread's cache counters into stats
+    static void collect_table_stats(search_stats_t &stats);
+    static auto pv_of(const result_t *p_result, BitBoard board) -> std::vector<std::string>;
 
     void fill_pv(const std::unique_ptr<const result_t> &p_result);
-    static auto move_to_uci(const Move &move, const BitBoard &board) -> std::string;
     auto move_to_uci(const Move &move) -> std::string { return move_to_uci(move, m_board); };
     static auto move_to_algebraic(const Move &move, BitBoard board) -> std::string;
     auto move_to_algebraic(const Move &move) -> std::string
@@ -41,9 +132,26 @@ class Engine
 
     auto handle_position(const std::string &token) -> bool;
     auto handle_go(const std::string &type_str, const std::string &value_str) -> bool;
+    static auto handle_test(const std::vector<std::string> &tokens) -> bool;
+    static auto handle_bench(const std::vector<std::string> &tokens) -> bool;
+    static auto handle_trace(const std::vector<std::string> &tokens) -> bool;
+    auto handle_stats(const std::vector<std::string> &tokens) -> bool;
+    auto handle_debug(const std::vector<std::string> &tokens) -> bool;
+    auto handle_info(const std::vector<std::string> &tokens) -> bool;
+    auto handle_nnue(const std::vector<std::string> &tokens) -> bool;
+    static auto handle_evalcache(const std::vector<std::string> &tokens) -> bool;
+    auto handle_eval(const std::vector<std::string> &tokens) -> bool;
+    void record_latency(latency_stage_t stage, std::chrono::steady_clock::time_point start);
+    auto handle_perft(const std::vector<std::string> &tokens) -> bool;
     static auto split_into_tokens(const std::string &str) -> std::vector<std::string>;
 
    public:
+    Engine() = default;
+    Engine(const Engine &) = delete;
+    auto operator=(const Engine &) -> Engine & = delete;
+    ~Engine();
+
+    static auto move_to_uci(const Move &move, const BitBoard &board) -> std::string;
     void uci_loop();
     static auto bitboard_to_string(const uint64_t &board) -> std::string;
     void run(std::chrono::seconds timeout);
@@ -52,4 +160,7 @@ class Engine
 
     auto get_uci() -> const std::string &;
     auto get_algebraic() -> const std::string &;
+    // nodes visited by the last run
+    [[nodiscard]] auto get_nodes() const -> uint64_t { return m_stats.nodes; }
+    [[nodiscard]] auto get_stats() const -> const search_stats_t & { return m_stats; }
 };
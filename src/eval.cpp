@@ -1,8 +1,24 @@
 #include "eval.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 #include "bitboard.h"
 #include "bitscan.h"
 #include "data.h"
+#include "material.h"
+#include "nnue.h"
+#include "pawns.h"
 
 using namespace std;
 
@@ -10,45 +26,307 @@ namespace
 {
 constexpr int mg_eg_piece_threshold = 24;
 
-template <piece_t Piece>
-void evaluate_pc(const BitBoard& board, int& mg_eval, int& eg_eval, int& mg_to_eg_eval)
+auto blend(const int midgame, const int endgame, const int phase) -> int
+{
+    if (phase > mg_eg_piece_threshold)
+    {
+        return midgame;
+    }
+    return (midgame * phase + endgame * (mg_eg_piece_threshold - phase)) / mg_eg_piece_threshold;
+}
+
+// the untraced evaluation takes one of these in place of an eval_trace_t, so it compiles to the
+// same code as if the tracing weren't there
+struct no_trace_t
+{
+};
+
+template <bool Trace>
+using trace_of = conditional_t<Trace, eval_trace_t, no_trace_t>;
+
+// the piece square totals piece by piece, which make_move only keeps the sum of
+void trace_pieces(const BitBoard& board, eval_trace_t& trace)
+{
+    for (const piece_t piece : piece_range::all())
+    {
+        psqt_t& total = trace.pieces.at(static_cast<size_t>(piece));
+        for (const auto bit : BitScan(board[piece]))
+        {
+            const int sq = __builtin_ctzll(bit);
+            total.midgame += pc_sq_table::packed[static_cast<size_t>(piece)][sq].midgame;
+            total.endgame += pc_sq_table::packed[static_cast<size_t>(piece)][sq].endgame;
+        }
+    }
+}
+
+// the piece square totals are kept up to date by make_move, the pawn structure comes from the
+// pawn table and the imbalance, phase and any known ending from the material table. All that's
+// left is scaling the endgame score and blending it with the midgame score by how much material
+// is left. The piece square and material part comes first, and with Lazy is all that's returned
+// when it is far enough outside the window. With nnue::enabled the network's evaluation is used
+// instead. With Trace every term is written to trace as well
+template <bool Lazy, bool Trace>
+auto evaluate(const BitBoard& board, const int alpha, const int beta,
+              [[maybe_unused]] trace_of<Trace>& trace) -> int
 {
-    for (auto pc_bit : BitScan(board[Piece]))
+    if (nnue::enabled)
     {
-        mg_eval += pc_sq_table::midgame<Piece>[__builtin_ctzll(pc_bit)];
-        eg_eval += pc_sq_table::endgame<Piece>[__builtin_ctzll(pc_bit)];
-        mg_to_eg_eval += pc_sq_table::mid_to_endgame_pc_val<Piece>;
+        if constexpr (Trace)
+        {
+            trace.source = "network";
+            trace.eval = nnue::evaluate(board);
+        }
+        return nnue::evaluate(board);
+    }
+    const material::entry_t& material_entry = material::table().probe(board);
+    if constexpr (Trace)
+    {
+        trace_pieces(board, trace);
+        trace.imbalance = {.midgame = material_entry.midgame, .endgame = material_entry.endgame};
+        trace.phase = material_entry.phase;
+    }
+    if (material_entry.evaluator != nullptr)
+    {
+        if constexpr (Trace)
+        {
+            trace.source = "known ending";
+            trace.eval = material_entry.evaluator(material::ending_of(board));
+        }
+        return material_entry.evaluator(material::ending_of(board));
+    }
+    const psqt_t& psqt = board.psqt();
+    int midgame = psqt.midgame + material_entry.midgame;
+    int endgame = psqt.endgame + material_entry.endgame;
+    const int phase = material_entry.phase;
+    // only an all midgame score without passers is bounded by the margin, and scaling depends on
+    // the whole endgame score, so anything else is always evaluated in full
+    if constexpr (Lazy)
+    {
+        lazy_counters_t& counters = lazy_counters();
+        counters.evals++;
+        if (phase > mg_eg_piece_threshold && material_entry.scalers[0] == nullptr &&
+            material_entry.scalers[1] == nullptr &&
+            !pawns::has_passers(board[piece_t::white_pawn], board[piece_t::black_pawn]))
+        {
+            const int cheap = blend(midgame, endgame, phase);
+            if (cheap + lazy_eval_margin < alpha || cheap - lazy_eval_margin > beta)
+            {
+                counters.exits++;
+                return cheap;
+            }
+        }
+    }
+    const pawns::entry_t& pawn_entry = pawns::table().probe(board);
+    midgame += pawn_entry.midgame + pawns::king_shields(pawn_entry, board);
+    endgame += pawn_entry.endgame;
+    if constexpr (Trace)
+    {
+        trace.pawns = {.midgame = pawn_entry.midgame, .endgame = pawn_entry.endgame};
+        trace.king_shields = pawns::king_shields(pawn_entry, board);
+        trace.total = {.midgame = midgame, .endgame = endgame};
+        trace.scale = material::scale(material_entry, board, endgame);
+        trace.eval = blend(midgame, endgame * trace.scale / material::scale_normal, phase);
+    }
+    endgame = endgame * material::scale(material_entry, board, endgame) / material::scale_normal;
+    return blend(midgame, endgame, phase);
+}
+
+// positions evaluate_batch gathers before blending them together
+constexpr size_t batch_block = 64;
+
+// the per position inputs to the final scale and blend of a block, one array per term
+struct batch_terms_t
+{
+    alignas(32) array<int32_t, batch_block> midgame;
+    alignas(32) array<int32_t, batch_block> endgame;
+    alignas(32) array<int32_t, batch_block> scale;
+    alignas(32) array<int32_t, batch_block> phase;
+};
+
+// what the known ending evaluators and scalers need of the position positions holds at idx
+auto ending_of(const eval_batch_t& positions, const size_t idx) -> material::ending_t
+{
+    return {.king_squares = {positions.king_squares[0][idx], positions.king_squares[1][idx]},
+            .bishops = {positions.bishops[0][idx], positions.bishops[1][idx]},
+            .psqt_endgame = positions.psqt[idx].endgame};
+}
+
+// what evaluate does after the table lookups, scaling each endgame score and blending it with the
+// midgame score by phase, for the first count positions of terms
+void blend_block(const batch_terms_t& terms, int* out, const size_t count)
+{
+    size_t idx = 0;
+#ifdef __AVX2__
+    static_assert(has_single_bit(static_cast<unsigned>(material::scale_normal)));
+    constexpr int scale_shift = countr_zero(static_cast<unsigned>(material::scale_normal));
+    const __m256i threshold = _mm256_set1_epi32(mg_eg_piece_threshold);
+    const __m256i round_up = _mm256_set1_epi32(material::scale_normal - 1);
+    const __m256 divisor = _mm256_set1_ps(static_cast<float>(mg_eg_piece_threshold));
+    for (; idx + 8 <= count; idx += 8)
+    {
+        const auto load = [idx](const array<int32_t, batch_block>& values)
+        { return _mm256_load_si256(reinterpret_cast<const __m256i*>(&values[idx])); };
+        const __m256i midgame = load(terms.midgame);
+        const __m256i phase = load(terms.phase);
+        // the shift rounds towards minus infinity, adding scale_normal - 1 to negative products
+        // first rounds them towards zero like the division does
+        const __m256i product = _mm256_mullo_epi32(load(terms.endgame), load(terms.scale));
+        const __m256i endgame = _mm256_srai_epi32(
+            _mm256_add_epi32(product, _mm256_and_si256(_mm256_srai_epi32(product, 31), round_up)),
+            scale_shift);
+        const __m256i sum = _mm256_add_epi32(
+            _mm256_mullo_epi32(midgame, phase),
+            _mm256_mullo_epi32(endgame, _mm256_sub_epi32(threshold, phase)));
+        // the sums are well inside the integers a float holds exactly, and a whole number over 24
+        // is never close enough to the next whole number to round up to it, so truncating the
+        // float quotient gives the same as the integer division
+        const __m256i blended =
+            _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(sum), divisor));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(out + idx),
+            _mm256_blendv_epi8(blended, midgame, _mm256_cmpgt_epi32(phase, threshold)));
+    }
+#endif
+    for (; idx < count; idx++)
+    {
+        out[idx] = blend(terms.midgame[idx],
+                         terms.endgame[idx] * terms.scale[idx] / material::scale_normal,
+                         terms.phase[idx]);
     }
 }
 }  // namespace
 
 auto evaluate(const BitBoard& board) -> int
 {
-    int mg_eval = 0;
-    int eg_eval = 0;
-    int mg_to_eg_counter = 0;
+    no_trace_t trace;
+    return evaluate<false, false>(board, numeric_limits<int>::min(), numeric_limits<int>::max(),
+                                  trace);
+}
 
-    evaluate_pc<piece_t::black_pawn>(board, mg_eval, eg_eval, mg_to_eg_counter);
-    evaluate_pc<piece_t::black_knight>(board, mg_eval, eg_eval, mg_to_eg_counter);
-    evaluate_pc<piece_t::black_bishop>(board, mg_eval, eg_eval, mg_to_eg_counter);
-    evaluate_pc<piece_t::black_rook>(board, mg_eval, eg_eval, mg_to_eg_counter);
-    evaluate_pc<piece_t::black_queen>(board, mg_eval, eg_eval, mg_to_eg_counter);
-    evaluate_pc<piece_t::black_king>(board, mg_eval, eg_eval, mg_to_eg_counter);
+auto evaluate(const BitBoard& board, const int alpha, const int beta) -> int
+{
+    no_trace_t trace;
+    return evaluate<true, false>(board, alpha, beta, trace);
+}
 
-    mg_eval = -mg_eval;
-    eg_eval = -eg_eval;
+void eval_batch_t::push_back(const BitBoard& board)
+{
+    psqt.push_back(board.psqt());
+    pawn_hash.push_back(board.pawn_hash());
+    material_key.push_back(board.material_key());
+    king_squares[0].push_back(static_cast<uint8_t>(__builtin_ctzll(board[piece_t::white_king])));
+    king_squares[1].push_back(static_cast<uint8_t>(__builtin_ctzll(board[piece_t::black_king])));
+    pawns[0].push_back(board[piece_t::white_pawn]);
+    pawns[1].push_back(board[piece_t::black_pawn]);
+    bishops[0].push_back(board[piece_t::white_bishop]);
+    bishops[1].push_back(board[piece_t::black_bishop]);
+    white_to_move.push_back(static_cast<uint8_t>(board.whites_turn()));
+    if (nnue::enabled)
+    {
+        accumulators.push_back(board.accumulator());
+    }
+}
 
-    evaluate_pc<piece_t::white_pawn>(board, mg_eval, eg_eval, mg_to_eg_counter);
-    evaluate_pc<piece_t::white_knight>(board, mg_eval, eg_eval, mg_to_eg_counter);
-    evaluate_pc<piece_t::white_bishop>(board, mg_eval, eg_eval, mg_to_eg_counter);
-    evaluate_pc<piece_t::white_rook>(board, mg_eval, eg_eval, mg_to_eg_counter);
-    evaluate_pc<piece_t::white_queen>(board, mg_eval, eg_eval, mg_to_eg_counter);
-    evaluate_pc<piece_t::white_king>(board, mg_eval, eg_eval, mg_to_eg_counter);
+void eval_batch_t::clear()
+{
+    psqt.clear();
+    pawn_hash.clear();
+    material_key.clear();
+    for (size_t side = 0; side < 2; side++)
+    {
+        king_squares.at(side).clear();
+        pawns.at(side).clear();
+        bishops.at(side).clear();
+    }
+    white_to_move.clear();
+    accumulators.clear();
+}
 
-    if (mg_to_eg_counter > mg_eg_piece_threshold)
+// The table lookups and scaler calls are per position, so a block of positions has its table
+// slots prefetched and its terms gathered into arrays first, then blended eight at a time. Known
+// endings skip the blend and the network is evaluated one position at a time as evaluate would
+auto evaluate_batch(const eval_batch_t& positions, const span<int> evals) -> bool
+{
+    if (evals.size() < positions.size())
+    {
+        return false;
+    }
+    if (nnue::enabled)
+    {
+        for (size_t idx = 0; idx < positions.size(); idx++)
+        {
+            evals[idx] = nnue::evaluate(positions.accumulators.at(idx),
+                                        positions.white_to_move[idx] != 0);
+        }
+        return true;
+    }
+    material::MaterialTable& material_table = material::table();
+    pawns::PawnTable& pawn_table = pawns::table();
+    batch_terms_t terms;
+    // positions of the block with a known ending, and their evaluations
+    array<size_t, batch_block> endings{};
+    array<int, batch_block> ending_evals{};
+    for (size_t first = 0; first < positions.size(); first += batch_block)
     {
-        return mg_eval;
+        const size_t count = min(batch_block, positions.size() - first);
+        size_t ending_count = 0;
+        // loading the whole block's table slots up front overlaps the misses of large datasets
+        for (size_t idx = first; idx < first + count; idx++)
+        {
+            material_table.prefetch(positions.material_key[idx]);
+            pawn_table.prefetch(positions.pawn_hash[idx]);
+        }
+        for (size_t idx = 0; idx < count; idx++)
+        {
+            const size_t pos = first + idx;
+            const uint64_t material_key = positions.material_key[pos];
+            const material::entry_t& material_entry = material_table.probe(
+                material_key, [material_key] { return material::compute(material_key); });
+            if (material_entry.evaluator != nullptr)
+            {
+                endings[ending_count] = idx;
+                ending_evals[ending_count++] = material_entry.evaluator(ending_of(positions, pos));
+                terms.midgame[idx] = 0;
+                terms.endgame[idx] = 0;
+                terms.scale[idx] = 0;
+                terms.phase[idx] = 0;
+                continue;
+            }
+            const pawns::entry_t& pawn_entry = pawn_table.probe(
+                positions.pawn_hash[pos], [&positions, pos]
+                { return pawns::compute(positions.pawns[0][pos], positions.pawns[1][pos]); });
+            const psqt_t& psqt = positions.psqt[pos];
+            const int endgame = psqt.endgame + material_entry.endgame + pawn_entry.endgame;
+            terms.midgame[idx] =
+                psqt.midgame + material_entry.midgame + pawn_entry.midgame +
+                pawns::king_shields(pawn_entry, positions.king_squares[0][pos],
+                                    positions.king_squares[1][pos]);
+            terms.endgame[idx] = endgame;
+            // the scalers are rare enough that only they pay for gathering what they look at
+            terms.scale[idx] =
+                material_entry.scalers[0] == nullptr && material_entry.scalers[1] == nullptr
+                    ? material::scale_normal
+                    : material::scale(material_entry, ending_of(positions, pos), endgame);
+            terms.phase[idx] = material_entry.phase;
+        }
+        blend_block(terms, &evals[first], count);
+        for (size_t ending = 0; ending < ending_count; ending++)
+        {
+            evals[first + endings[ending]] = ending_evals[ending];
+        }
     }
-    return (mg_eval * mg_to_eg_counter + eg_eval * (mg_eg_piece_threshold - mg_to_eg_counter)) /
-           mg_eg_piece_threshold;
-}
\ No newline at end of file
+    return true;
+}
+
+auto lazy_counters() -> lazy_counters_t&
+{
+    thread_local lazy_counters_t counters;
+    return counters;
+}
+
+auto trace_evaluation(const BitBoard& board) -> eval_trace_t
+{
+    eval_trace_t trace;
+    evaluate<false, true>(board, numeric_limits<int>::min(), numeric_limits<int>::max(), trace);
+    return trace;
+}
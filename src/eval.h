@@ -1,8 +1,76 @@
 #pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
 
 #include "bitboard.h"
+#include "nnue.h"
+#include "pawns.h"
 
 static constexpr int checkmate_eval = 30000;
 static constexpr int early_checkmate_incentive = 2000;
 
-auto evaluate(const BitBoard &board) -> int;
\ No newline at end of file
+// The most the pawn terms can move a score that is all midgame once there are no passers, which
+// is when a score further than this outside the window is returned without them. Anything with
+// passers or an endgame share is evaluated in full, as each passer adds a bonus of its own
+static constexpr int lazy_eval_margin = pawns::max_midgame_without_passers;
+
+// evaluations asked for with a window by the calling thread, and how many the cheap part settled
+struct lazy_counters_t
+{
+    uint64_t evals = 0;
+    uint64_t exits = 0;
+};
+
+// every term that went into an evaluation, from white's side
+struct eval_trace_t
+{
+    // what gave the evaluation, "tables" for the terms below, "network" or "known ending"
+    std::string_view source = "tables";
+    // each piece_t's piece square total, black's counting against white
+    std::array<psqt_t, 12> pieces{};
+    psqt_t imbalance;
+    psqt_t pawns;
+    int king_shields = 0;
+    psqt_t total;
+    // the endgame total was scaled by this out of material::scale_normal
+    int scale = 0;
+    int phase = 0;
+    int eval = 0;
+};
+
+// Many positions laid out for evaluate_batch, one array per part of a position that it reads, so
+// a batch streams through just those rather than through whole BitBoards
+struct eval_batch_t
+{
+    std::vector<psqt_t> psqt;
+    std::vector<uint64_t> pawn_hash;
+    std::vector<uint64_t> material_key;
+    // each indexed by side_t
+    std::array<std::vector<uint8_t>, 2> king_squares;
+    std::array<std::vector<uint64_t>, 2> pawns;
+    std::array<std::vector<uint64_t>, 2> bishops;
+    std::vector<uint8_t> white_to_move;
+    // only filled in for positions added while nnue::enabled is set, which evaluate_batch needs
+    // whenever it is set
+    std::vector<nnue::accumulator_t> accumulators;
+
+    void push_back(const BitBoard &board);
+    void clear();
+    [[nodiscard]] auto size() const -> size_t { return psqt.size(); }
+};
+
+auto evaluate(const BitBoard &board) -> int;
+// the evaluation when it is inside [alpha, beta], otherwise a score on the same side of the
+// window that may leave out the terms lazy_eval_margin covers. Only scores within the margin of
+// the window are certain to be the full evaluation
+auto evaluate(const BitBoard &board, int alpha, int beta) -> int;
+// evals[idx] is the evaluate of the position positions holds at idx, with the last steps
+// vectorised across them. False, leaving evals alone, when there are fewer evals than positions
+[[nodiscard]] auto evaluate_batch(const eval_batch_t &positions, std::span<int> evals) -> bool;
+auto lazy_counters() -> lazy_counters_t &;
+// the full evaluation of board broken down into its terms, too slow for searching
+auto trace_evaluation(const BitBoard &board) -> eval_trace_t;
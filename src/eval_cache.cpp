@@ -0,0 +1,74 @@
+#include "eval_cache.h"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "bitboard.h"
+
+using namespace std;
+
+namespace
+{
+atomic<size_t> wanted_entries = eval_cache::default_entries;
+// bumped by every resize and invalidate, each thread's cache remembers the one it was built at
+atomic<uint64_t> generation = 0;
+}  // namespace
+
+void eval_cache::resize(const size_t entries)
+{
+    wanted_entries = entries > 0 ? bit_floor(entries) : 0;
+    generation++;
+}
+
+void eval_cache::invalidate() { generation++; }
+
+eval_cache::EvalCache::EvalCache(const size_t entries) : m_entries(entries)
+{
+    m_mask = entries > 0 ? entries - 1 : 0;
+    // a key only ever lands in the slot its low bits pick, so a key with different low bits can
+    // never be mistaken for a stored one, whatever position hashes to it
+    for (size_t idx = 0; idx < m_entries.size(); idx++)
+    {
+        m_entries[idx] = {.key = (idx ^ 1) & m_mask, .eval = 0};
+    }
+}
+
+auto eval_cache::EvalCache::probe(const BitBoard &board, int &eval) -> bool
+{
+    if (m_entries.size() < 2)
+    {
+        return false;
+    }
+    const entry_t &entry = m_entries[board.hash() & m_mask];
+    m_probes++;
+    if (entry.key != board.hash())
+    {
+        return false;
+    }
+    m_hits++;
+    eval = entry.eval;
+    return true;
+}
+
+void eval_cache::EvalCache::store(const BitBoard &board, const int eval)
+{
+    if (m_entries.size() < 2)
+    {
+        return;
+    }
+    m_entries[board.hash() & m_mask] = {.key = board.hash(), .eval = eval};
+}
+
+auto eval_cache::table() -> EvalCache &
+{
+    thread_local EvalCache cache(wanted_entries);
+    thread_local uint64_t built_at = generation;
+    if (built_at != generation)
+    {
+        cache = EvalCache(wanted_entries);
+        built_at = generation;
+    }
+    return cache;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bitboard.h"
+
+// The evaluations of positions the search has already evaluated, which iterative deepening and
+// transpositions keep coming back to. Each thread has a direct mapped EvalCache keyed by the
+// whole of BitBoard::hash, so an entry is only used for the position that stored it
+namespace eval_cache
+{
+inline constexpr size_t default_entries = 1 << 16;
+
+// the number of entries each thread's cache should have from now on, rounded down to a power of
+// two, 0 turns the cache off
+void resize(size_t entries);
+// drops everything cached, for when the evaluation itself has changed
+void invalidate();
+
+class EvalCache
+{
+   public:
+    explicit EvalCache(size_t entries);
+
+    // the evaluation stored for board, if there is one
+    [[nodiscard]] auto probe(const BitBoard &board, int &eval) -> bool;
+    void store(const BitBoard &board, int eval);
+
+    [[nodiscard]] auto size() const -> size_t { return m_entries.size(); }
+    [[nodiscard]] auto probes() const -> uint64_t { return m_probes; }
+    [[nodiscard]] auto hits() const -> uint64_t { return m_hits; }
+    void clear_counters()
+    {
+        m_probes = 0;
+        m_hits = 0;
+    }
+
+   private:
+    struct entry_t
+    {
+        uint64_t key;
+        int32_t eval;
+    };
+
+    std::vector<entry_t> m_entries;
+    uint64_t m_mask = 0;
+    uint64_t m_probes = 0;
+    uint64_t m_hits = 0;
+};
+
+// the calling thread's cache, rebuilt empty after a resize or invalidate
+auto table() -> EvalCache &;
+}  // namespace eval_cache
@@ -0,0 +1,61 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Durations bucketed by powers of two nanoseconds, so recording is a bit scan and an increment
+// and percentiles come back as the upper bound of their bucket, within a factor of two
+class LatencyHistogram
+{
+   private:
+    static constexpr size_t bucket_count = 64;
+
+    std::array<uint64_t, bucket_count> m_buckets{};
+    uint64_t m_count = 0;
+    uint64_t m_total_ns = 0;
+    uint64_t m_max_ns = 0;
+
+   public:
+    void record(const std::chrono::nanoseconds elapsed)
+    {
+        const auto ns = static_cast<uint64_t>(std::max<int64_t>(elapsed.count(), 0));
+        m_buckets[std::min<size_t>(std::bit_width(ns), bucket_count - 1)]++;
+        m_count++;
+        m_total_ns += ns;
+        m_max_ns = std::max(m_max_ns, ns);
+    }
+
+    [[nodiscard]] auto count() const -> uint64_t { return m_count; }
+
+    [[nodiscard]] auto mean() const -> std::chrono::nanoseconds
+    {
+        return std::chrono::nanoseconds(m_count == 0 ? 0 : m_total_ns / m_count);
+    }
+
+    [[nodiscard]] auto max() const -> std::chrono::nanoseconds
+    {
+        return std::chrono::nanoseconds(m_max_ns);
+    }
+
+    // the upper bound of the bucket holding the pct'th percentile, never above the maximum seen
+    [[nodiscard]] auto percentile(const int pct) const -> std::chrono::nanoseconds
+    {
+        const uint64_t rank = (m_count * static_cast<uint64_t>(pct) + 99) / 100;
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < bucket_count; bucket++)
+        {
+            seen += m_buckets[bucket];
+            if (seen >= rank && seen > 0)
+            {
+                const uint64_t upper = bucket == 0 ? 0 : (1ULL << bucket) - 1;
+                return std::chrono::nanoseconds(std::min(upper, m_max_ns));
+            }
+        }
+        return std::chrono::nanoseconds(0);
+    }
+
+    void clear() { *this = LatencyHistogram(); }
+};
@@ -1,9 +1,41 @@
+#include <exception>
+#include <print>
+#include <string>
+#include <string_view>
+
 #include "engine.h"
+#include "nnue.h"
+#include "testing.h"
 
 using namespace std;
 
-auto main() -> int
+// ElwellBot bench [depth] [perf] runs the search bench and exits, otherwise the engine reads
+// commands
+auto main(int argc, char* argv[]) -> int
 {
+    if (argc > 1 && string_view(argv[1]) == "bench")
+    {
+        const bool perf = string_view(argv[argc - 1]) == "perf";
+        const int depth_args = argc - (perf ? 3 : 2);
+        int depth = default_search_bench_depth;
+        try
+        {
+            if (depth_args > 0)
+            {
+                depth = stoi(argv[2]);
+            }
+        }
+        catch (exception& e)
+        {
+            println("Failed at stoi: [{}]", argv[2]);
+            println("Usage: ElwellBot bench [depth] [perf]");
+            return 1;
+        }
+        run_search_bench(depth, perf);
+        return 0;
+    }
+    // the built in network stays in use when there's no network file to map
+    nnue::load(nnue::default_network_file);
     Engine engine;
     engine.uci_loop();
 }
@@ -0,0 +1,57 @@
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <string>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile(const string &filename)
+{
+#ifdef __unix__
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat info{};
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        void *mapped =
+            mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED)
+        {
+            m_data = static_cast<const std::byte *>(mapped);
+            m_size = static_cast<size_t>(info.st_size);
+        }
+    }
+    close(fd);
+#else
+    ifstream file(filename, ios::binary);
+    for (auto it = istreambuf_iterator<char>(file); it != istreambuf_iterator<char>(); ++it)
+    {
+        m_contents.push_back(static_cast<std::byte>(*it));
+    }
+    m_data = m_contents.data();
+    m_size = m_contents.size();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef __unix__
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<std::byte *>(m_data), m_size);  // NOLINT
+    }
+#endif
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+// A read only view of a whole file, memory mapped on unix and read into memory elsewhere. A file
+// that can't be opened reads as empty
+class MappedFile
+{
+   private:
+    const std::byte *m_data = nullptr;
+    size_t m_size = 0;
+#ifndef __unix__
+    std::vector<std::byte> m_contents;
+#endif
+
+   public:
+    explicit MappedFile(const std::string &filename);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    auto operator=(const MappedFile &) -> MappedFile & = delete;
+    MappedFile(MappedFile &&) = delete;
+    auto operator=(MappedFile &&) -> MappedFile & = delete;
+
+    [[nodiscard]] auto bytes() const -> std::span<const std::byte> { return {m_data, m_size}; }
+};
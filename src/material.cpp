@@ -0,0 +1,202 @@
+#include "material.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include "bitboard.h"
+#include "data.h"
+
+using namespace std;
+
+namespace
+{
+constexpr int bishop_pair_midgame = 30;
+constexpr int bishop_pair_endgame = 50;
+// per piece for each own pawn above or below five, knights need pawns to hold on to and rooks
+// need open files
+constexpr int knight_pawn_adjust = 3;
+constexpr int rook_pawn_adjust = -6;
+// a second rook adds less than the first
+constexpr int redundant_rook = -10;
+
+// what the stronger side gets on top of its material in an ending it knows how to win, enough
+// to make trading into one worthwhile
+constexpr int known_win = 400;
+constexpr int lone_king_edge_bonus = 30;
+constexpr int king_proximity_bonus = 10;
+
+// winning chances of a rook against a minor piece without pawns, and with opposite coloured
+// bishops
+constexpr int rook_against_minor_scale = 16;
+constexpr int opposite_bishops_scale = 32;
+
+struct side_counts_t
+{
+    int pawns;
+    int knights;
+    int bishops;
+    int rooks;
+    int queens;
+
+    [[nodiscard]] auto pieces() const -> int { return knights + bishops + rooks + queens; }
+    // enough to mate a lone king, pawns counting as they can promote
+    [[nodiscard]] auto can_mate() const -> bool
+    {
+        return pawns > 0 || queens > 0 || rooks > 0 || bishops >= 2 ||
+               (bishops >= 1 && knights >= 1);
+    }
+};
+
+template <side_t Side>
+auto counts_of(const uint64_t key) -> side_counts_t
+{
+    using traits = side_traits<Side>;
+    return {.pawns = material::count(key, traits::pawn),
+            .knights = material::count(key, traits::knight),
+            .bishops = material::count(key, traits::bishop),
+            .rooks = material::count(key, traits::rook),
+            .queens = material::count(key, traits::queen)};
+}
+
+void add_imbalance(const side_counts_t &counts, const int sign, material::entry_t &entry)
+{
+    int midgame = 0;
+    int endgame = 0;
+    if (counts.bishops >= 2)
+    {
+        midgame += bishop_pair_midgame;
+        endgame += bishop_pair_endgame;
+    }
+    const int adjust = (counts.knights * knight_pawn_adjust * (counts.pawns - 5)) +
+                       (counts.rooks * rook_pawn_adjust * (counts.pawns - 5)) +
+                       (counts.rooks >= 2 ? redundant_rook : 0);
+    midgame += adjust;
+    endgame += adjust;
+    entry.midgame = static_cast<int16_t>(entry.midgame + (sign * midgame));
+    entry.endgame = static_cast<int16_t>(entry.endgame + (sign * endgame));
+}
+
+// squares from the centre, 0 for the middle four and 3 on the edge
+auto centre_distance(const int sq) -> int
+{
+    return max(abs((2 * (sq % 8)) - 7), abs((2 * (sq / 8)) - 7)) / 2;
+}
+
+auto king_distance(const int sq_a, const int sq_b) -> int
+{
+    return max(abs((sq_a % 8) - (sq_b % 8)), abs((sq_a / 8) - (sq_b / 8)));
+}
+
+auto evaluate_draw(const material::ending_t & /*ending*/) -> int { return 0; }
+
+// enough material against a bare king, which wins by driving the king to the edge with its own
+template <side_t Strong>
+auto evaluate_lone_king(const material::ending_t &ending) -> int
+{
+    const int winner = ending.king_squares[static_cast<size_t>(Strong)];
+    const int loser = ending.king_squares[static_cast<size_t>(~Strong)];
+    const int material = Strong == side_t::white ? ending.psqt_endgame : -ending.psqt_endgame;
+    const int score = material + known_win + (lone_king_edge_bonus * centre_distance(loser)) +
+                      (king_proximity_bonus * (7 - king_distance(winner, loser)));
+    return Strong == side_t::white ? score : -score;
+}
+
+auto scale_rook_against_minor(const material::ending_t & /*ending*/) -> int
+{
+    return rook_against_minor_scale;
+}
+
+auto scale_opposite_bishops(const material::ending_t &ending) -> int
+{
+    const int white_sq = __builtin_ctzll(ending.bishops[static_cast<size_t>(side_t::white)]);
+    const int black_sq = __builtin_ctzll(ending.bishops[static_cast<size_t>(side_t::black)]);
+    const int white_colour = ((white_sq % 8) + (white_sq / 8)) % 2;
+    const int black_colour = ((black_sq % 8) + (black_sq / 8)) % 2;
+    return white_colour != black_colour ? opposite_bishops_scale : material::scale_normal;
+}
+
+// the side with just a rook against just a knight or bishop
+auto rook_against_minor(const side_counts_t &strong, const side_counts_t &weak) -> bool
+{
+    return strong.pieces() == 1 && strong.rooks == 1 && weak.pieces() == 1 &&
+           weak.rooks == 0 && weak.queens == 0;
+}
+}  // namespace
+
+auto material::compute(const uint64_t key) -> entry_t
+{
+    entry_t entry{};
+    for (size_t piece = 0; piece < pc_sq_table::phase.size(); piece++)
+    {
+        entry.phase += count(key, static_cast<piece_t>(piece)) * pc_sq_table::phase[piece];
+    }
+    const side_counts_t white = counts_of<side_t::white>(key);
+    const side_counts_t black = counts_of<side_t::black>(key);
+    add_imbalance(white, 1, entry);
+    add_imbalance(black, -1, entry);
+
+    if (white.pawns == 0 && black.pawns == 0)
+    {
+        if (!white.can_mate() && !black.can_mate())
+        {
+            entry.evaluator = evaluate_draw;
+        }
+        else if (black.pieces() == 0 && white.can_mate())
+        {
+            entry.evaluator = evaluate_lone_king<side_t::white>;
+        }
+        else if (white.pieces() == 0 && black.can_mate())
+        {
+            entry.evaluator = evaluate_lone_king<side_t::black>;
+        }
+        if (rook_against_minor(white, black))
+        {
+            entry.scalers[static_cast<size_t>(side_t::white)] = scale_rook_against_minor;
+        }
+        if (rook_against_minor(black, white))
+        {
+            entry.scalers[static_cast<size_t>(side_t::black)] = scale_rook_against_minor;
+        }
+    }
+    if (white.pieces() == 1 && white.bishops == 1 && black.pieces() == 1 && black.bishops == 1)
+    {
+        entry.scalers = {scale_opposite_bishops, scale_opposite_bishops};
+    }
+    return entry;
+}
+
+auto material::ending_of(const BitBoard &board) -> ending_t
+{
+    return {.king_squares = {__builtin_ctzll(board[piece_t::white_king]),
+                             __builtin_ctzll(board[piece_t::black_king])},
+            .bishops = {board[piece_t::white_bishop], board[piece_t::black_bishop]},
+            .psqt_endgame = board.psqt().endgame};
+}
+
+auto material::scale(const entry_t &entry, const BitBoard &board, const int endgame) -> int
+{
+    const scaler_t scaler =
+        entry.scalers[static_cast<size_t>(endgame > 0 ? side_t::white : side_t::black)];
+    return scaler != nullptr ? scaler(ending_of(board)) : scale_normal;
+}
+
+auto material::scale(const entry_t &entry, const ending_t &ending, const int endgame) -> int
+{
+    const scaler_t scaler =
+        entry.scalers[static_cast<size_t>(endgame > 0 ? side_t::white : side_t::black)];
+    return scaler != nullptr ? scaler(ending) : scale_normal;
+}
+
+auto material::compute(const BitBoard &board) -> entry_t
+{
+    return compute(board.material_key());
+}
+
+auto material::table() -> MaterialTable &
+{
+    // no position has a key of zero, there are always two kings
+    thread_local MaterialTable material_table(entry_t{});
+    return material_table;
+}
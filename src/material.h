@@ -0,0 +1,67 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "bitboard.h"
+#include "direct_table.h"
+
+// Everything in the evaluation that only depends on how many of each piece there are: the game
+// phase, imbalance terms, and for endings with a known outcome either an evaluator that replaces
+// the usual one or a scaling of the endgame score towards a draw. Entries are keyed by
+// BitBoard::material_key, which is the piece counts themselves, and cached per thread in a
+// MaterialTable so routine positions only pay the lookup
+namespace material
+{
+// endgame scores are scaled by a factor out of this
+inline constexpr int scale_normal = 64;
+
+// What the known ending evaluators and scalers look at, little enough to fill in for a batch of
+// positions without their BitBoards
+struct ending_t
+{
+    // each indexed by side_t
+    std::array<int, 2> king_squares;
+    std::array<uint64_t, 2> bishops;
+    // the piece square endgame total from white's side
+    int psqt_endgame;
+};
+
+auto ending_of(const BitBoard &board) -> ending_t;
+
+using evaluator_t = auto (*)(const ending_t &ending) -> int;
+using scaler_t = auto (*)(const ending_t &ending) -> int;
+
+struct entry_t
+{
+    uint64_t key;
+    // white's imbalance terms less black's
+    int16_t midgame;
+    int16_t endgame;
+    // the non pawn material left weighted by pc_sq_table::phase, 48 at the start
+    int phase;
+    // the whole evaluation from white's side for endings that have one, otherwise null
+    evaluator_t evaluator;
+    // the winning chances of the side indexed by side_t when it is the one ahead in the endgame,
+    // out of scale_normal, null when they are normal
+    std::array<scaler_t, 2> scalers;
+};
+
+constexpr auto count(const uint64_t key, const piece_t piece) -> int
+{
+    return static_cast<int>((key / material_unit(piece)) & 0xF);
+}
+
+// the entry for key, without the key
+auto compute(uint64_t key) -> entry_t;
+// the entry for board's material key, without the key
+auto compute(const BitBoard &board) -> entry_t;
+
+// the factor out of scale_normal to scale the endgame score endgame by
+auto scale(const entry_t &entry, const BitBoard &board, int endgame) -> int;
+auto scale(const entry_t &entry, const ending_t &ending, int endgame) -> int;
+
+using MaterialTable = DirectTable<entry_t, 1 << 13, &BitBoard::material_key, compute>;
+
+// the calling thread's table
+auto table() -> MaterialTable &;
+}  // namespace material
@@ -110,6 +110,22 @@ auto Move::copy(const Move &mov) -> Move
     return Move{mov.pc1, mov.mov1, mov.pc2, mov.mov2, mov.pc3, mov.mov3, mov.info, mov.type};
 }
 
+auto Move::squares(const BitBoard &board) const -> move_squares_t
+{
+    const uint64_t from = mov1 & board[pc1];
+    switch (type)
+    {
+        case movType::CAPTURE:
+            return {.from = from, .to = mov1 & ~from, .captured = mov2};
+        case movType::PROMOTE:
+            return {.from = from, .to = mov2, .captured = 0};
+        case movType::CAPTURE_PROMOTE:
+            return {.from = from, .to = mov3, .captured = mov2};
+        default:
+            return {.from = from, .to = mov1 & ~from, .captured = 0};
+    }
+}
+
 auto Move::to_string() const -> string
 {
     string out = format("Move Type: {} | Primary piece_t: {}", move_type_to_string(type),
@@ -42,6 +42,15 @@ constexpr auto operator-(const movType type_a, const movType type_b) -> int
     return static_cast<int>(type_a) - static_cast<int>(type_b);
 }
 
+// the squares a move's main piece leaves and lands on, and the square of any piece it captures,
+// which is off the target square for en passent
+struct move_squares_t
+{
+    uint64_t from;
+    uint64_t to;
+    uint64_t captured;
+};
+
 struct Move
 {
     // NOLINTBEGIN(misc-non-private-member-variables-in-classes)
@@ -79,5 +88,6 @@ struct Move
                                  uint64_t info, uint64_t board_info) -> Move;
 
     static auto copy(const Move &mov) -> Move;
+    [[nodiscard]] auto squares(const BitBoard &board) const -> move_squares_t;
     [[nodiscard]] auto to_string() const -> std::string;
 };
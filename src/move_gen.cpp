@@ -5,663 +5,241 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "attacks.h"
 #include "bitboard.h"
 #include "bitscan.h"
 #include "data.h"
 #include "move.h"
+#include "see.h"
 
 using namespace std;
 
-auto MoveGen::get_white_rook_attacks(const uint64_t rook) const -> uint64_t
-{
-    const int pos = __builtin_ctzll(rook);
-    const int rank = pos >> 3;
-    const int file = pos & 7;
-    const int base = pos & ~7;
-    uint64_t attacks =
-        (uint64_t)(move_masks::sliding_moves[(((m_board[piece_t::all_pcs] >> (base + 1)) &
-                                               move_masks::sliding_moves_mask)
-                                              << 3) +
-                                             file])
-        << base;
-
-    const uint64_t file_isolated = m_board[piece_t::all_pcs] << (8 - file) & masks::file_h;
-    const uint64_t rotated = (file_isolated * masks::anti_diag) >> 56;
-    const uint64_t index = (rotated * 8 + (7 - rank)) & 0x1ff;
-    const uint64_t moves_rotated = ((uint64_t)move_masks::sliding_moves[index]) * masks::anti_diag;
-    attacks |= (moves_rotated & masks::file_a) >> (7 - file);
-
-    return attacks & ~m_board[piece_t::white_pcs];
-}
-
-auto MoveGen::get_black_rook_attacks(const uint64_t rook) const -> uint64_t
-{
-    const int pos = __builtin_ctzll(rook);
-    const int rank = pos >> 3;
-    const int file = pos & 7;
-    const int base = pos & ~7;
-
-    uint64_t attacks =
-        (uint64_t)(move_masks::sliding_moves[(((m_board[piece_t::all_pcs] >> (base + 1)) &
-                                               move_masks::sliding_moves_mask)
-                                              << 3) +
-                                             file])
-        << base;
-
-    const uint64_t file_isolated = m_board[piece_t::all_pcs] << (8 - file) & masks::file_h;
-    const uint64_t rotated = (file_isolated * masks::anti_diag) >> 56;
-    const uint64_t index = (rotated * 8 + (7 - rank)) & 0x1ff;
-    const uint64_t moves_rotated = ((uint64_t)move_masks::sliding_moves[index]) * masks::anti_diag;
-    attacks |= (moves_rotated & masks::file_a) >> (7 - file);
-
-    return attacks & ~m_board[piece_t::black_pcs];
-}
-
-auto MoveGen::get_white_bishop_attacks(const uint64_t bishop) const -> uint64_t
-{
-    uint64_t up_ray = 0;
-    uint64_t down_ray = 0;
-    uint64_t mask = 0;
-    uint64_t temp = 0;
-    uint64_t first_pc = 0;
-    uint64_t spots = 0;
-    const int pos = __builtin_ctzll(bishop);
-    up_ray = masks::diag_up[(pos & 7) + (pos >> 3)];
-    down_ray = masks::diag_down[7 + (pos >> 3) - (pos & 7)];
-
-    const uint64_t sqs_ahead = ~((bishop - 1) | bishop);
-    const uint64_t pcs_ahead = m_board[piece_t::all_pcs] & sqs_ahead;
-    const uint64_t pcs_behind = m_board[piece_t::all_pcs] & (bishop - 1);
-
-    first_pc = pcs_ahead & -(pcs_ahead & up_ray) & up_ray;
-    spots = ((first_pc - 1) & sqs_ahead & up_ray) | (first_pc & m_board[piece_t::black_pcs]);
-
-    temp = pcs_behind & up_ray;
-    mask = static_cast<int>(temp == 0) - 1;
-    first_pc = (sq_a8 >> __builtin_clzll(temp)) & mask;
-    spots |= (bishop - 1) & ~((first_pc - 1) | first_pc) & up_ray;
-    spots |= first_pc & m_board[piece_t::black_pcs];
-    spots |= up_ray & (bishop - 1) & ~mask;
-
-    first_pc = pcs_ahead & -(pcs_ahead & down_ray) & down_ray;
-    spots |= ((first_pc - 1) & sqs_ahead & down_ray) | (first_pc & m_board[piece_t::black_pcs]);
-
-    temp = pcs_behind & down_ray;
-    mask = static_cast<int>(temp == 0) - 1;
-    first_pc = (sq_a8 >> __builtin_clzll(temp)) & mask;
-    spots |= (bishop - 1) & ~((first_pc - 1) | first_pc) & down_ray;
-    spots |= first_pc & m_board[piece_t::black_pcs];
-    spots |= down_ray & (bishop - 1) & ~mask;
-    return spots;
-}
-
-auto MoveGen::get_black_bishop_attacks(const uint64_t bishop) const -> uint64_t
-{
-    uint64_t up_ray = 0;
-    uint64_t down_ray = 0;
-    uint64_t mask = 0;
-    uint64_t temp = 0;
-    uint64_t first_pc = 0;
-    uint64_t spots = 0;
-    const int pos = __builtin_ctzll(bishop);
-    up_ray = masks::diag_up[(pos & 7) + (pos >> 3)];
-    down_ray = masks::diag_down[7 + (pos >> 3) - (pos & 7)];
-
-    const uint64_t sqs_ahead = ~((bishop - 1) | bishop);
-    const uint64_t pcs_ahead = m_board[piece_t::all_pcs] & sqs_ahead;
-    const uint64_t pcs_behind = m_board[piece_t::all_pcs] & (bishop - 1);
-
-    first_pc = pcs_ahead & -(pcs_ahead & up_ray) & up_ray;
-    spots = ((first_pc - 1) & sqs_ahead & up_ray) | (first_pc & m_board[piece_t::white_pcs]);
-
-    temp = pcs_behind & up_ray;
-    mask = static_cast<int>(temp == 0) - 1;
-    first_pc = (sq_a8 >> __builtin_clzll(temp)) & mask;
-    spots |= (bishop - 1) & ~((first_pc - 1) | first_pc) & up_ray;
-    spots |= first_pc & m_board[piece_t::white_pcs];
-    spots |= up_ray & (bishop - 1) & ~mask;
-
-    first_pc = pcs_ahead & -(pcs_ahead & down_ray) & down_ray;
-    spots |= ((first_pc - 1) & sqs_ahead & down_ray) | (first_pc & m_board[piece_t::white_pcs]);
-
-    temp = pcs_behind & down_ray;
-    mask = static_cast<int>(temp == 0) - 1;
-    first_pc = (sq_a8 >> __builtin_clzll(temp)) & mask;
-    spots |= (bishop - 1) & ~((first_pc - 1) | first_pc) & down_ray;
-    spots |= first_pc & m_board[piece_t::white_pcs];
-    spots |= down_ray & (bishop - 1) & ~mask;
-    return spots;
-}
-
-void MoveGen::get_white_knight_moves()
+template <side_t Side>
+void MoveGen::get_knight_moves()
 {
-    for (const auto knight : BitScan(m_board[piece_t::white_knight]))
+    using traits = side_traits<Side>;
+    for (const auto knight : BitScan(m_board[traits::knight]))
     {
         const uint64_t moves =
-            move_masks::knight_moves[__builtin_ctzll(knight)] & ~m_board[piece_t::white_pcs];
-        white_add_to_movs(piece_t::white_knight, knight, moves, 0);
+            move_masks::knight_moves[__builtin_ctzll(knight)] & ~m_board[traits::own_pcs];
+        add_to_movs<Side>(traits::knight, knight, moves, 0);
     }
 }
 
-void MoveGen::get_black_knight_moves()
+template <side_t Side>
+void MoveGen::get_rook_moves()
 {
-    for (const auto knight : BitScan(m_board[piece_t::black_knight]))
+    using traits = side_traits<Side>;
+    for (const auto rook : BitScan(m_board[traits::rook]))
     {
         const uint64_t moves =
-            move_masks::knight_moves[__builtin_ctzll(knight)] & ~m_board[piece_t::black_pcs];
-        black_add_to_movs(piece_t::black_knight, knight, moves, 0);
-    }
-}
-
-void MoveGen::get_white_rook_moves()
-{
-    for (const auto rook : BitScan(m_board[piece_t::white_rook]))
-    {
-        const uint64_t moves = get_white_rook_attacks(rook);
-        const uint64_t info = m_board[piece_t::info] & rook &
-                              (castling::white_kingside_right | castling::white_queenside_right);
-        white_add_to_movs(piece_t::white_rook, rook, moves, info);
-    }
-}
-
-void MoveGen::get_black_rook_moves()
-{
-    for (const auto rook : BitScan(m_board[piece_t::black_rook]))
-    {
-        const uint64_t moves = get_black_rook_attacks(rook);
-        const uint64_t info = m_board[piece_t::info] & rook &
-                              (castling::black_kingside_right | castling::black_queenside_right);
-        black_add_to_movs(piece_t::black_rook, rook, moves, info);
-    }
-}
-
-void MoveGen::get_white_bishop_moves()
-{
-    for (const auto bishop : BitScan(m_board[piece_t::white_bishop]))
-    {
-        const uint64_t moves = get_white_bishop_attacks(bishop);
-
-        white_add_to_movs(piece_t::white_bishop, bishop, moves, 0);
+            rook_attacks(rook, m_board[piece_t::all_pcs]) & ~m_board[traits::own_pcs];
+        const uint64_t info =
+            m_board[piece_t::info] & rook & (traits::kingside_right | traits::queenside_right);
+        add_to_movs<Side>(traits::rook, rook, moves, info);
     }
 }
 
-void MoveGen::get_black_bishop_moves()
+template <side_t Side>
+void MoveGen::get_bishop_moves()
 {
-    for (const auto bishop : BitScan(m_board[piece_t::black_bishop]))
+    using traits = side_traits<Side>;
+    for (const auto bishop : BitScan(m_board[traits::bishop]))
     {
-        const uint64_t moves = get_black_bishop_attacks(bishop);
+        const uint64_t moves =
+            bishop_attacks(bishop, m_board[piece_t::all_pcs]) & ~m_board[traits::own_pcs];
 
-        black_add_to_movs(piece_t::black_bishop, bishop, moves, 0);
+        add_to_movs<Side>(traits::bishop, bishop, moves, 0);
     }
 }
 
-void MoveGen::get_white_pawn_moves()
+template <side_t Side>
+void MoveGen::get_pawn_moves()
 {
-    for (const auto one_step :
-         BitScan((m_board[piece_t::white_pawn] << 8) & ~masks::rank_8 & ~m_board[piece_t::all_pcs]))
-    {
-        m_movs[m_idx++] =
-            Move::quiet(piece_t::white_pawn, one_step | one_step >> 8, 0, m_board[piece_t::info]);
-    }
-    for (const auto one_step_prom :
-         BitScan((m_board[piece_t::white_pawn] << 8) & masks::rank_8 & ~m_board[piece_t::all_pcs]))
-    {
-        m_movs[m_idx++] =
-            Move::promote(piece_t::white_pawn, one_step_prom >> 8, piece_t::white_queen,
-                          one_step_prom, 0, m_board[piece_t::info]);
-        m_movs[m_idx++] =
-            Move::promote(piece_t::white_pawn, one_step_prom >> 8, piece_t::white_knight,
-                          one_step_prom, 0, m_board[piece_t::info]);
-        m_movs[m_idx++] =
-            Move::promote(piece_t::white_pawn, one_step_prom >> 8, piece_t::white_rook,
-                          one_step_prom, 0, m_board[piece_t::info]);
-        m_movs[m_idx++] =
-            Move::promote(piece_t::white_pawn, one_step_prom >> 8, piece_t::white_bishop,
-                          one_step_prom, 0, m_board[piece_t::info]);
-    }
-
-    const uint64_t two_steps = ((m_board[piece_t::white_pawn] & masks::rank_2) << 16) &
-                               ~((m_board[piece_t::all_pcs]) | (m_board[piece_t::all_pcs] << 8));
+    using traits = side_traits<Side>;
+    const uint64_t one_steps =
+        traits::forward(m_board[traits::pawn], 8) & ~m_board[piece_t::all_pcs];
+    for (const auto one_step : BitScan(one_steps & ~traits::promotion_rank))
+    {
+        m_movs[m_idx++] = Move::quiet(traits::pawn, one_step | traits::backward(one_step, 8), 0,
+                                      m_board[piece_t::info]);
+    }
+    for (const auto one_step_prom : BitScan(one_steps & traits::promotion_rank))
+    {
+        const uint64_t from = traits::backward(one_step_prom, 8);
+        m_movs[m_idx++] = Move::promote(traits::pawn, from, traits::queen, one_step_prom, 0,
+                                        m_board[piece_t::info]);
+        m_movs[m_idx++] = Move::promote(traits::pawn, from, traits::knight, one_step_prom, 0,
+                                        m_board[piece_t::info]);
+        m_movs[m_idx++] = Move::promote(traits::pawn, from, traits::rook, one_step_prom, 0,
+                                        m_board[piece_t::info]);
+        m_movs[m_idx++] = Move::promote(traits::pawn, from, traits::bishop, one_step_prom, 0,
+                                        m_board[piece_t::info]);
+    }
+
+    const uint64_t two_steps =
+        traits::forward(m_board[traits::pawn] & traits::double_push_rank, 16) &
+        ~(m_board[piece_t::all_pcs] | traits::forward(m_board[piece_t::all_pcs], 8));
     for (const auto two_step : BitScan(two_steps))
-    {
-        m_movs[m_idx++] = Move::quiet(piece_t::white_pawn, two_step | two_step >> 16,
-                                      (two_step >> 8), m_board[piece_t::info]);
-    }
-
-    white_pawn_taking_moves(7);
-    white_pawn_taking_moves(9);
-
-    const uint64_t en_passent_take_left =
-        ((m_board[piece_t::white_pawn] << 9) & m_board[piece_t::info] & ~masks::rank_1 &
-         ~masks::file_h);
-    if (en_passent_take_left != 0)
-    {
-        m_movs[m_idx++] = Move::capture(
-            piece_t::white_pawn, en_passent_take_left | (en_passent_take_left >> 9),
-            piece_t::black_pawn, en_passent_take_left >> 8, 0, m_board[piece_t::info]);
-    }
-
-    const uint64_t en_passent_take_right =
-        ((m_board[piece_t::white_pawn] << 7) & m_board[piece_t::info] & ~masks::rank_1 &
-         ~masks::file_a);
-    if (en_passent_take_right != 0)
-    {
-        m_movs[m_idx++] = Move::capture(
-            piece_t::white_pawn, en_passent_take_right | (en_passent_take_right >> 7),
-            piece_t::black_pawn, en_passent_take_right >> 8, 0, m_board[piece_t::info]);
-    }
-}
-
-void MoveGen::get_black_pawn_moves()
-{
-    for (const auto one_step :
-         BitScan((m_board[piece_t::black_pawn] >> 8) & ~masks::rank_1 & ~m_board[piece_t::all_pcs]))
-    {
-        m_movs[m_idx++] =
-            Move::quiet(piece_t::black_pawn, one_step | one_step << 8, 0, m_board[piece_t::info]);
-    }
-
-    for (const auto one_step_prom :
-         BitScan((m_board[piece_t::black_pawn] >> 8) & masks::rank_1 & ~m_board[piece_t::all_pcs]))
     {
         m_movs[m_idx++] =
-            Move::promote(piece_t::black_pawn, one_step_prom << 8, piece_t::black_queen,
-                          one_step_prom, 0, m_board[piece_t::info]);
-        m_movs[m_idx++] =
-            Move::promote(piece_t::black_pawn, one_step_prom << 8, piece_t::black_knight,
-                          one_step_prom, 0, m_board[piece_t::info]);
-        m_movs[m_idx++] =
-            Move::promote(piece_t::black_pawn, one_step_prom << 8, piece_t::black_rook,
-                          one_step_prom, 0, m_board[piece_t::info]);
-        m_movs[m_idx++] =
-            Move::promote(piece_t::black_pawn, one_step_prom << 8, piece_t::black_bishop,
-                          one_step_prom, 0, m_board[piece_t::info]);
+            Move::quiet(traits::pawn, two_step | traits::backward(two_step, 16),
+                        traits::backward(two_step, 8), m_board[piece_t::info]);
     }
 
-    const uint64_t two_steps = ((m_board[piece_t::black_pawn] & masks::rank_7) >> 16) &
-                               ~((m_board[piece_t::all_pcs]) | (m_board[piece_t::all_pcs] >> 8));
-    for (const auto two_step : BitScan(two_steps))
-    {
-        m_movs[m_idx++] = Move::quiet(piece_t::black_pawn, two_step | two_step << 16,
-                                      (two_step << 8), m_board[piece_t::info]);
-    }
+    pawn_taking_moves<Side, traits::h_side_capture>();
+    pawn_taking_moves<Side, traits::a_side_capture>();
 
-    black_pawn_taking_moves(9);
-    black_pawn_taking_moves(7);
+    const uint64_t en_passent_target = m_board[piece_t::info] & traits::en_passent_rank;
     const uint64_t en_passent_take_left =
-        ((m_board[piece_t::black_pawn] >> 7) & m_board[piece_t::info] & ~masks::rank_1 &
-         ~masks::file_h);
+        traits::forward(m_board[traits::pawn], traits::a_side_capture) & en_passent_target &
+        ~masks::file_h;
     if (en_passent_take_left != 0)
     {
         m_movs[m_idx++] = Move::capture(
-            piece_t::black_pawn, en_passent_take_left | (en_passent_take_left << 7),
-            piece_t::white_pawn, en_passent_take_left << 8, 0, m_board[piece_t::info]);
+            traits::pawn,
+            en_passent_take_left | traits::backward(en_passent_take_left, traits::a_side_capture),
+            traits::enemy_pawn, traits::backward(en_passent_take_left, 8), 0,
+            m_board[piece_t::info]);
     }
 
     const uint64_t en_passent_take_right =
-        ((m_board[piece_t::black_pawn] >> 9) & m_board[piece_t::info] & ~masks::rank_1 &
-         ~masks::file_a);
+        traits::forward(m_board[traits::pawn], traits::h_side_capture) & en_passent_target &
+        ~masks::file_a;
     if (en_passent_take_right != 0)
     {
         m_movs[m_idx++] = Move::capture(
-            piece_t::black_pawn, en_passent_take_right | (en_passent_take_right << 9),
-            piece_t::white_pawn, en_passent_take_right << 8, 0, m_board[piece_t::info]);
-    }
-}
-
-void MoveGen::black_pawn_taking_moves(const int offset)
-{
-    uint64_t const file_mask = offset == 7 ? masks::file_h : masks::file_a;
-    for (const auto take_right : BitScan((m_board[piece_t::black_pawn] >> offset) &
-                                         m_board[piece_t::white_pcs] & ~file_mask))
-    {
-        for (auto const piece : piece_range::WhiteNoKing())
-        {
-            const uint64_t taken_piece = (take_right & m_board[piece]);
-            if (taken_piece == 0)
-            {
-                continue;
-            }
-            const uint64_t promotion_sq = (take_right & masks::rank_1);
-            if (promotion_sq != 0)
-            {
-                m_movs[m_idx++] = Move::promote_capture(piece_t::black_pawn, take_right << offset,
-                                                        piece, taken_piece, piece_t::black_queen,
-                                                        promotion_sq, 0, m_board[piece_t::info]);
-                m_movs[m_idx++] = Move::promote_capture(piece_t::black_pawn, take_right << offset,
-                                                        piece, taken_piece, piece_t::black_knight,
-                                                        promotion_sq, 0, m_board[piece_t::info]);
-                m_movs[m_idx++] = Move::promote_capture(piece_t::black_pawn, take_right << offset,
-                                                        piece, taken_piece, piece_t::black_bishop,
-                                                        promotion_sq, 0, m_board[piece_t::info]);
-                m_movs[m_idx++] = Move::promote_capture(piece_t::black_pawn, take_right << offset,
-                                                        piece, taken_piece, piece_t::black_rook,
-                                                        promotion_sq, 0, m_board[piece_t::info]);
-            }
-            else
-            {
-                m_movs[m_idx++] =
-                    Move::capture(piece_t::black_pawn, take_right | take_right << offset, piece,
-                                  taken_piece, 0, m_board[piece_t::info]);
-            }
-            break;
-        }
-    }
-}
-
-void MoveGen::white_pawn_taking_moves(const int offset)
-{
-    uint64_t const file_mask = offset == 7 ? masks::file_a : masks::file_h;
-    for (const auto take : BitScan((m_board[piece_t::white_pawn] << offset) &
-                                   m_board[piece_t::black_pcs] & ~file_mask))
-    {
-        for (auto const piece : piece_range::BlackNoKing())
-        {
-            const uint64_t taken_piece = (take & m_board[piece]);
-            if (taken_piece == 0)
-            {
-                continue;
-            }
-            const uint64_t promotion_sq = (take & masks::rank_8);
-            if (promotion_sq != 0)
-            {
-                m_movs[m_idx++] = Move::promote_capture(piece_t::white_pawn, take >> offset, piece,
-                                                        taken_piece, piece_t::white_queen,
-                                                        promotion_sq, 0, m_board[piece_t::info]);
-                m_movs[m_idx++] = Move::promote_capture(piece_t::white_pawn, take >> offset, piece,
-                                                        taken_piece, piece_t::white_knight,
-                                                        promotion_sq, 0, m_board[piece_t::info]);
-                m_movs[m_idx++] = Move::promote_capture(piece_t::white_pawn, take >> offset, piece,
-                                                        taken_piece, piece_t::white_bishop,
-                                                        promotion_sq, 0, m_board[piece_t::info]);
-                m_movs[m_idx++] = Move::promote_capture(piece_t::white_pawn, take >> offset, piece,
-                                                        taken_piece, piece_t::white_rook,
-                                                        promotion_sq, 0, m_board[piece_t::info]);
-            }
-            else
-            {
-                m_movs[m_idx++] = Move::capture(piece_t::white_pawn, take | take >> offset, piece,
-                                                taken_piece, 0, m_board[piece_t::info]);
-            }
-            break;
-        }
+            traits::pawn,
+            en_passent_take_right | traits::backward(en_passent_take_right, traits::h_side_capture),
+            traits::enemy_pawn, traits::backward(en_passent_take_right, 8), 0,
+            m_board[piece_t::info]);
     }
 }
 
-void MoveGen::get_white_king_moves()
+template <side_t Side, int Offset>
+void MoveGen::pawn_taking_moves()
 {
-    const uint64_t moves =
-        move_masks::king_moves.at(__builtin_ctzll(m_board[piece_t::white_king])) &
-        ~m_board[piece_t::white_pcs];
-    const uint64_t info_xor =
-        (castling::white_kingside_right | castling::white_queenside_right) & m_board[piece_t::info];
-
-    white_add_to_movs(piece_t::white_king, m_board[piece_t::white_king], moves, info_xor);
-
-    uint64_t attacks = 0;
-    if (((m_board[piece_t::info] & castling::white_kingside_right) != 0) &&
-        ((castling::white_kingside_space &
-          (m_board[piece_t::white_pcs] | m_board[piece_t::black_pcs])) == 0) &&
-        ((m_board[piece_t::white_rook] & masks::file_h & masks::rank_1) != 0))
-    {
-        attacks = get_black_attackers(m_board);
-        if ((attacks & castling::white_kingside_attacked) == 0)
-        {
-            m_movs[m_idx++] = Move::castle_kingside(
-                piece_t::white_king, castling::white_kingside_king_move, piece_t::white_rook,
-                castling::white_kingside_rook_move, info_xor, m_board[piece_t::info]);
-        }
-    }
-    if (((m_board[piece_t::info] & castling::white_queenside_right) != 0) &&
-        ((castling::white_queenside_space &
-          (m_board[piece_t::white_pcs] | m_board[piece_t::black_pcs])) == 0) &&
-        ((m_board[piece_t::white_rook] & masks::file_a & masks::rank_1) != 0))
-    {
-        if (attacks == 0)
+    using traits = side_traits<Side>;
+    constexpr uint64_t file_mask = Offset == traits::a_side_capture ? masks::file_h : masks::file_a;
+    for (const auto take :
+         BitScan(traits::forward(m_board[traits::pawn], Offset) & m_board[traits::enemy_pcs] &
+                 ~m_board[traits::enemy_king] & ~file_mask))
+    {
+        const piece_t piece = m_board.piece_on(__builtin_ctzll(take));
+        const uint64_t from = traits::backward(take, Offset);
+        const uint64_t promotion_sq = (take & traits::promotion_rank);
+        if (promotion_sq != 0)
         {
-            attacks = get_black_attackers(m_board);
+            m_movs[m_idx++] = Move::promote_capture(traits::pawn, from, piece, take, traits::queen,
+                                                    promotion_sq, 0, m_board[piece_t::info]);
+            m_movs[m_idx++] = Move::promote_capture(traits::pawn, from, piece, take, traits::knight,
+                                                    promotion_sq, 0, m_board[piece_t::info]);
+            m_movs[m_idx++] = Move::promote_capture(traits::pawn, from, piece, take, traits::bishop,
+                                                    promotion_sq, 0, m_board[piece_t::info]);
+            m_movs[m_idx++] = Move::promote_capture(traits::pawn, from, piece, take, traits::rook,
+                                                    promotion_sq, 0, m_board[piece_t::info]);
         }
-
-        if ((attacks & castling::white_queenside_attacked) == 0)
+        else
         {
-            m_movs[m_idx++] = Move::castle_queenside(
-                piece_t::white_king, castling::white_queenside_king_move, piece_t::white_rook,
-                castling::white_queenside_rook_move, info_xor, m_board[piece_t::info]);
+            m_movs[m_idx++] =
+                Move::capture(traits::pawn, take | from, piece, take, 0, m_board[piece_t::info]);
         }
     }
 }
 
-void MoveGen::get_black_king_moves()
+template <side_t Side>
+void MoveGen::get_king_moves()
 {
-    const uint64_t moves =
-        move_masks::king_moves.at(__builtin_ctzll(m_board[piece_t::black_king])) &
-        ~m_board[piece_t::black_pcs];
-
+    using traits = side_traits<Side>;
+    const uint64_t moves = move_masks::king_moves.at(__builtin_ctzll(m_board[traits::king])) &
+                           ~m_board[traits::own_pcs];
     const uint64_t info_xor =
-        (castling::black_kingside_right | castling::black_queenside_right) & m_board[piece_t::info];
+        (traits::kingside_right | traits::queenside_right) & m_board[piece_t::info];
 
-    black_add_to_movs(piece_t::black_king, m_board[piece_t::black_king], moves, info_xor);
+    add_to_movs<Side>(traits::king, m_board[traits::king], moves, info_xor);
 
-    uint64_t attacks = 0;
-    if (((m_board[piece_t::info] & castling::black_kingside_right) != 0) &&
-        ((castling::black_kingside_space &
-          (m_board[piece_t::white_pcs] | m_board[piece_t::black_pcs])) == 0) &&
-        ((m_board[piece_t::black_rook] & masks::file_h & masks::rank_8) != 0))
+    const bool kingside = ((m_board[piece_t::info] & traits::kingside_right) != 0) &&
+                          ((traits::kingside_space & m_board[piece_t::all_pcs]) == 0) &&
+                          ((m_board[traits::rook] & masks::file_h & traits::back_rank) != 0);
+    const bool queenside = ((m_board[piece_t::info] & traits::queenside_right) != 0) &&
+                           ((traits::queenside_space & m_board[piece_t::all_pcs]) == 0) &&
+                           ((m_board[traits::rook] & masks::file_a & traits::back_rank) != 0);
+    if (!kingside && !queenside)
     {
-        attacks = get_white_attackers(m_board);
-        if ((attacks & castling::black_kingside_attacked) == 0)
-        {
-            m_movs[m_idx++] = Move::castle_kingside(
-                piece_t::black_king, castling::black_kingside_king_move, piece_t::black_rook,
-                castling::black_kingside_rook_move, info_xor, m_board[piece_t::info]);
-        }
+        return;
     }
-
-    if (((m_board[piece_t::info] & castling::black_queenside_right) != 0) &&
-        ((castling::black_queenside_space &
-          (m_board[piece_t::white_pcs] | m_board[piece_t::black_pcs])) == 0) &&
-        ((m_board[piece_t::black_rook] & masks::file_a & masks::rank_8) != 0))
+    // only put together once a castle is otherwise possible, most positions never get here
+    const uint64_t attacks = m_board.attacks_by(~Side);
+    if (kingside && (attacks & traits::kingside_attacked) == 0)
     {
-        if (attacks == 0)
-        {
-            attacks = get_white_attackers(m_board);
-        }
-
-        if ((attacks & castling::black_queenside_attacked) == 0)
-        {
-            m_movs[m_idx++] = Move::castle_queenside(
-                piece_t::black_king, castling::black_queenside_king_move, piece_t::black_rook,
-                castling::black_queenside_rook_move, info_xor, m_board[piece_t::info]);
-        }
+        m_movs[m_idx++] = Move::castle_kingside(traits::king, traits::kingside_king_move,
+                                                traits::rook, traits::kingside_rook_move, info_xor,
+                                                m_board[piece_t::info]);
     }
-}
-
-void MoveGen::get_white_queen_moves()
-{
-    for (const auto queen : BitScan(m_board[piece_t::white_queen]))
+    if (queenside && (attacks & traits::queenside_attacked) == 0)
     {
-        const uint64_t moves = get_white_bishop_attacks(queen) | get_white_rook_attacks(queen);
-
-        white_add_to_movs(piece_t::white_queen, queen, moves, 0);
+        m_movs[m_idx++] = Move::castle_queenside(traits::king, traits::queenside_king_move,
+                                                 traits::rook, traits::queenside_rook_move,
+                                                 info_xor, m_board[piece_t::info]);
     }
 }
 
-void MoveGen::get_black_queen_moves()
+template <side_t Side>
+void MoveGen::get_queen_moves()
 {
-    for (const auto queen : BitScan(m_board[piece_t::black_queen]))
+    using traits = side_traits<Side>;
+    for (const auto queen : BitScan(m_board[traits::queen]))
     {
-        const uint64_t moves = get_black_bishop_attacks(queen) | get_black_rook_attacks(queen);
+        const uint64_t moves = (bishop_attacks(queen, m_board[piece_t::all_pcs]) |
+                                rook_attacks(queen, m_board[piece_t::all_pcs])) &
+                               ~m_board[traits::own_pcs];
 
-        black_add_to_movs(piece_t::black_queen, queen, moves, 0);
+        add_to_movs<Side>(traits::queen, queen, moves, 0);
     }
 }
 
-void MoveGen::white_add_to_movs(const piece_t moving_pc, const uint64_t moving_pc_spot,
-                                const uint64_t moves, const uint64_t info)
+template <side_t Side>
+void MoveGen::add_to_movs(const piece_t moving_pc, const uint64_t moving_pc_spot,
+                          const uint64_t moves, const uint64_t info)
 {
+    using traits = side_traits<Side>;
     const uint64_t board_info = m_board[piece_t::info];
 
-    for (const auto mov : BitScan(moves & ~m_board[piece_t::black_pcs]))
-    {
-        m_movs[m_idx++] = Move::quiet(moving_pc, mov | moving_pc_spot, info, board_info);
-    }
-
-    for (const auto taking_spot : BitScan(moves & m_board[piece_t::black_pcs]))
-    {
-        for (const auto taken_pc : piece_range::BlackNoKing())
-        {
-            const uint64_t taken_spot = (taking_spot & m_board[taken_pc]);
-            if (taken_spot != 0)
-            {
-                m_movs[m_idx++] = Move::capture(moving_pc, taken_spot | moving_pc_spot, taken_pc,
-                                                taken_spot, info, board_info);
-                break;
-            }
-        }
-    }
-}
-
-void MoveGen::black_add_to_movs(const piece_t moving_pc, const uint64_t moving_pc_spot,
-                                const uint64_t moves, const uint64_t info)
-{
-    const uint64_t board_info = m_board[piece_t::info];
-    for (const auto mov : BitScan(moves & ~m_board[piece_t::white_pcs]))
+    for (const auto mov : BitScan(moves & ~m_board[traits::enemy_pcs]))
     {
         m_movs[m_idx++] = Move::quiet(moving_pc, mov | moving_pc_spot, info, board_info);
     }
 
-    for (const auto taking_spot : BitScan(moves & m_board[piece_t::white_pcs]))
-    {
-        for (const auto taken_pc : piece_range::WhiteNoKing())
-        {
-            const uint64_t taken_spot = (taking_spot & m_board[taken_pc]);
-            if (taken_spot != 0)
-            {
-                m_movs[m_idx++] = Move::capture(moving_pc, taken_spot | moving_pc_spot, taken_pc,
-                                                taken_spot, info, board_info);
-                break;
-            }
-        }
-    }
-}
-
-auto MoveGen::get_white_attackers(const BitBoard &m_board) -> uint64_t
-{
-    uint64_t attacks = 0;
-    attacks |= ((m_board[piece_t::white_pawn] & ~masks::file_h) << 7) |
-               ((m_board[piece_t::white_pawn] & ~masks::file_a) << 9);
-
-    attacks |= move_masks::king_moves.at(__builtin_ctzll(m_board[piece_t::white_king]));
-
-    for (const auto piece : BitScan(m_board[piece_t::white_knight]))
-    {
-        attacks |= move_masks::knight_moves.at(__builtin_ctzll(piece));
-    }
-
-    for (const auto piece :
-         BitScan((m_board[piece_t::white_bishop] | m_board[piece_t::white_queen])))
-    {
-        attacks |= get_white_bishop_attacks(piece);
-    }
-
-    for (const auto piece : BitScan((m_board[piece_t::white_rook] | m_board[piece_t::white_queen])))
-    {
-        attacks |= get_white_rook_attacks(piece);
-    }
-
-    return attacks;
-}
-
-auto MoveGen::get_black_attackers(const BitBoard &m_board) -> uint64_t
-{
-    uint64_t attacks = 0;
-
-    attacks |= ((m_board[piece_t::black_pawn] & ~masks::file_h) >> 9) |
-               ((m_board[piece_t::black_pawn] & ~masks::file_a) >> 7);
-
-    attacks |= move_masks::king_moves.at(__builtin_ctzll(m_board[piece_t::black_king]));
-
-    for (const auto piece : BitScan(m_board[piece_t::black_knight]))
+    for (const auto taken_spot :
+         BitScan(moves & m_board[traits::enemy_pcs] & ~m_board[traits::enemy_king]))
     {
-        attacks |= move_masks::knight_moves.at(__builtin_ctzll(piece));
+        const piece_t taken_pc = m_board.piece_on(__builtin_ctzll(taken_spot));
+        m_movs[m_idx++] = Move::capture(moving_pc, taken_spot | moving_pc_spot, taken_pc,
+                                        taken_spot, info, board_info);
     }
-
-    for (const auto piece : BitScan(m_board[piece_t::black_bishop] | m_board[piece_t::black_queen]))
-    {
-        attacks |= get_black_bishop_attacks(piece);
-    }
-
-    for (const auto piece : BitScan(m_board[piece_t::black_rook] | m_board[piece_t::black_queen]))
-    {
-        attacks |= get_black_rook_attacks(piece);
-    }
-
-    return attacks;
 }
 
-// NOLINTBEGIN
-auto MoveGen::is_white_king_in_check() const -> bool
+template <side_t Side>
+auto MoveGen::is_king_in_check() const -> bool
 {
-    if (((m_board[piece_t::black_rook] | m_board[piece_t::black_queen]) &
-         get_white_rook_attacks(m_board[piece_t::white_king])) != 0)
-    {
-        return true;
-    }
-    if (((m_board[piece_t::black_bishop] | m_board[piece_t::black_queen]) &
-         get_white_bishop_attacks(m_board[piece_t::white_king])) != 0)
-    {
-        return true;
-    }
-    if ((m_board[piece_t::black_knight] &
-         move_masks::knight_moves.at(__builtin_ctzll(m_board[piece_t::white_king]))) != 0)
-    {
-        return true;
-    }
-    if ((m_board[piece_t::black_king] &
-         move_masks::king_moves.at(__builtin_ctzll(m_board[piece_t::white_king]))) != 0)
-    {
-        return true;
-    }
-    if (((((m_board[piece_t::white_king] << 9) & ~masks::file_h) |
-          ((m_board[piece_t::white_king] << 7) & ~masks::file_a)) &
-         m_board[piece_t::black_pawn]) != 0)
-    {
-        return true;
-    }
-    return false;
+    return (m_board.attacks_by(~Side) & m_board[side_traits<Side>::king]) != 0;
 }
 
-auto MoveGen::is_black_king_in_check() const -> bool
+template <side_t Side>
+auto MoveGen::is_legal(const Move &move) const -> bool
 {
-    if (((m_board[piece_t::white_rook] | m_board[piece_t::white_queen]) &
-         get_black_rook_attacks(m_board[piece_t::black_king])) != 0)
-    {
-        return true;
-    }
-    if (((m_board[piece_t::white_bishop] | m_board[piece_t::white_queen]) &
-         get_black_bishop_attacks(m_board[piece_t::black_king])) != 0)
-    {
-        return true;
-    }
-    if ((m_board[piece_t::white_knight] &
-         move_masks::knight_moves.at(__builtin_ctzll(m_board[piece_t::black_king]))) != 0)
-    {
-        return true;
-    }
-    if (((m_board[piece_t::white_king] &
-          move_masks::king_moves.at(__builtin_ctzll(m_board[piece_t::black_king])))) != 0)
+    using traits = side_traits<Side>;
+    // castling already checks every square the king crosses
+    if (move.type == movType::CASTLE_kingside || move.type == movType::CASTLE_queenside)
     {
         return true;
     }
-    if (((((m_board[piece_t::black_king] >> 9) & ~masks::file_a) |
-          ((m_board[piece_t::black_king] >> 7) & ~masks::file_h)) &
-         m_board[piece_t::white_pawn]) != 0)
-    {
-        return true;
-    }
-    return false;
+    const auto [from, to, captured] = move.squares(m_board);
+    const uint64_t occupied = (m_board[piece_t::all_pcs] & ~from & ~captured) | to;
+    const uint64_t king = m_board[traits::king] == from ? to : m_board[traits::king];
+    return (m_board.attackers_to(__builtin_ctzll(king), occupied) & m_board[traits::enemy_pcs] &
+            ~captured) == 0;
 }
-// NOLINTEND
 
 auto MoveGen::compare_moves(const Move &mov_a, const Move &mov_b) -> bool
 {
@@ -709,30 +287,43 @@ auto MoveGen::at(size_t idx) const -> const Move & { return m_movs[idx]; }
 template <side_t Side>
 void MoveGen::gen()
 {
-    if constexpr (Side == side_t::white)
-    {
-        get_white_queen_moves();
-        get_white_rook_moves();
-        get_white_bishop_moves();
-        get_white_knight_moves();
-        get_white_pawn_moves();
-        get_white_king_moves();
-    }
-    else
-    {
-        get_black_queen_moves();
-        get_black_rook_moves();
-        get_black_bishop_moves();
-        get_black_knight_moves();
-        get_black_pawn_moves();
-        get_black_king_moves();
-    }
+    get_queen_moves<Side>();
+    get_rook_moves<Side>();
+    get_bishop_moves<Side>();
+    get_knight_moves<Side>();
+    get_pawn_moves<Side>();
+    get_king_moves<Side>();
 
     m_end_idx = static_cast<ptrdiff_t>(m_idx);
     sort(m_movs.begin(), m_movs.begin() + m_end_idx, MoveGen::compare_moves);
 }
 
+void MoveGen::demote_losing_captures()
+{
+    // Taking a piece worth at least the capturer can't lose, so only the rest need the exchange
+    // evaluated. Captures sort straight before the quiet moves
+    const auto moves_begin = m_movs.begin();
+    auto capture = partition_point(moves_begin, moves_begin + m_end_idx, [](const Move &move)
+                                   { return move.type != movType::QUIET; });
+    auto losing_begin = capture;
+    while (capture != moves_begin && (capture - 1)->type == movType::CAPTURE)
+    {
+        --capture;
+        if (see_piece_values[static_cast<size_t>(capture->pc1) % see_piece_values.size()] >
+                see_piece_values[static_cast<size_t>(capture->pc2) % see_piece_values.size()] &&
+            !see_ge(m_board, *capture, 0))
+        {
+            rotate(capture, capture + 1, losing_begin);
+            --losing_begin;
+        }
+    }
+}
+
 MoveGen::MoveGen(const BitBoard &board) : m_board(board) {}
 
 template void MoveGen::gen<side_t::white>();
-template void MoveGen::gen<side_t::black>();
\ No newline at end of file
+template void MoveGen::gen<side_t::black>();
+template auto MoveGen::is_king_in_check<side_t::white>() const -> bool;
+template auto MoveGen::is_king_in_check<side_t::black>() const -> bool;
+template auto MoveGen::is_legal<side_t::white>(const Move &) const -> bool;
+template auto MoveGen::is_legal<side_t::black>(const Move &) const -> bool;
@@ -18,39 +18,24 @@ class MoveGen
     const BitBoard &m_board;
     ptrdiff_t m_end_idx = 0;
 
-    void black_add_to_movs(piece_t moving_pc, uint64_t moving_pc_spot, uint64_t moves,
-                           uint64_t info = 0);
-    void white_add_to_movs(piece_t moving_pc, uint64_t moving_pc_spot, uint64_t moves,
-                           uint64_t info = 0);
-
-    [[nodiscard]] auto get_white_rook_attacks(uint64_t rook) const -> uint64_t;
-    [[nodiscard]] auto get_black_rook_attacks(uint64_t rook) const -> uint64_t;
-    [[nodiscard]] auto get_white_bishop_attacks(uint64_t bishop) const -> uint64_t;
-    [[nodiscard]] auto get_black_bishop_attacks(uint64_t bishop) const -> uint64_t;
-
-    void get_white_knight_moves();
-    void get_black_knight_moves();
-
-    void get_white_bishop_moves();
-    void get_black_bishop_moves();
-
-    void get_white_rook_moves();
-    void get_black_rook_moves();
-
-    void get_white_pawn_moves();
-    void get_black_pawn_moves();
-
-    void white_pawn_taking_moves(int offset);
-    void black_pawn_taking_moves(int offset);
-
-    void get_white_queen_moves();
-    void get_black_queen_moves();
-
-    void get_white_king_moves();
-    void get_black_king_moves();
-
-    void get_white_moves();
-    void get_black_moves();
+    template <side_t Side>
+    void add_to_movs(piece_t moving_pc, uint64_t moving_pc_spot, uint64_t moves,
+                     uint64_t info = 0);
+
+    template <side_t Side>
+    void get_knight_moves();
+    template <side_t Side>
+    void get_bishop_moves();
+    template <side_t Side>
+    void get_rook_moves();
+    template <side_t Side>
+    void get_pawn_moves();
+    template <side_t Side, int Offset>
+    void pawn_taking_moves();
+    template <side_t Side>
+    void get_queen_moves();
+    template <side_t Side>
+    void get_king_moves();
 
     static auto compare_moves(const Move &mov_a, const Move &mov_b) -> bool;
 
@@ -64,27 +49,17 @@ class MoveGen
     auto at(size_t idx) -> Move &;
     [[nodiscard]] auto at(size_t idx) const -> const Move &;
 
-    [[nodiscard]] auto is_white_king_in_check() const -> bool;
-    [[nodiscard]] auto is_black_king_in_check() const -> bool;
-
-    template <side_t side>
-    [[nodiscard]] constexpr auto is_king_in_check() const -> bool
-    {
-        if constexpr (side == side_t::white)
-        {
-            return is_white_king_in_check();
-        }
-        else
-        {
-            return is_black_king_in_check();
-        }
-    }
-
-    auto get_white_attackers(const BitBoard &board) -> uint64_t;
-    auto get_black_attackers(const BitBoard &board) -> uint64_t;
+    template <side_t Side>
+    [[nodiscard]] auto is_king_in_check() const -> bool;
+    // whether a generated move keeps Side's king out of check, without making it
+    template <side_t Side>
+    [[nodiscard]] auto is_legal(const Move &move) const -> bool;
 
-    template <side_t side>
+    template <side_t Side>
     void gen();
+    // moves captures that lose material in the exchange behind the other captures, keeping their
+    // order. Perft has no use for it so it is left out of gen
+    void demote_losing_captures();
 
     MoveGen(const BitBoard &board);
 
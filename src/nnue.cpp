@@ -0,0 +1,313 @@
+#include "nnue.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "bitboard.h"
+#include "data.h"
+#include "mapped_file.h"
+
+using namespace std;
+
+namespace
+{
+// the next count values of T in bytes, moving offset past them
+template <typename T>
+auto take(const span<const std::byte> bytes, size_t &offset, const size_t count) -> span<const T>
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const span<const T> values(reinterpret_cast<const T *>(bytes.data() + offset), count);
+    offset += count * sizeof(T);
+    return values;
+}
+
+auto parse(const span<const std::byte> bytes) -> optional<nnue::network_t>
+{
+    using namespace nnue;
+    network_t net{};
+    if (bytes.size() != network_bytes)
+    {
+        return nullopt;
+    }
+    memcpy(&net.header, bytes.data(), sizeof(network_header_t));
+    if (net.header.magic != network_magic || net.header.king_buckets != king_buckets ||
+        net.header.features != features || net.header.hidden != hidden ||
+        net.header.l1_size != l1_size || net.header.output_divisor <= 0)
+    {
+        return nullopt;
+    }
+    size_t offset = sizeof(network_header_t);
+    net.ft_biases = take<int16_t>(bytes, offset, hidden);
+    net.ft_weights = take<int16_t>(bytes, offset, features * hidden);
+    net.l1_biases = take<int32_t>(bytes, offset, l1_size);
+    net.l1_weights = take<int8_t>(bytes, offset, l1_size * 2 * hidden);
+    net.output_bias = take<int32_t>(bytes, offset, 1);
+    net.output_weights = take<int8_t>(bytes, offset, l1_size);
+    return net;
+}
+
+template <typename T>
+void append(vector<std::byte> &bytes, const span<const T> values)
+{
+    const auto *first = reinterpret_cast<const std::byte *>(values.data());  // NOLINT
+    bytes.insert(bytes.end(), first, first + values.size_bytes());
+}
+
+// hidden units of the built in network: own pawns on each half of the board, then one per own
+// piece kind, then the same for the opponent's pieces
+constexpr size_t default_units_per_side = 7;
+constexpr int default_value_scale = 10;
+// keeps the kings' units, which can be negative, clear of the clip at zero
+constexpr int default_king_bias = 20;
+
+template <piece_t Piece>
+auto default_value(const int sq) -> int
+{
+    return (pc_sq_table::midgame<Piece>[sq] + pc_sq_table::endgame<Piece>[sq]) / 2;
+}
+
+auto white_piece_value(const size_t kind, const int sq) -> int
+{
+    switch (kind)
+    {
+        case 0:
+            return default_value<piece_t::white_pawn>(sq);
+        case 1:
+            return default_value<piece_t::white_knight>(sq);
+        case 2:
+            return default_value<piece_t::white_bishop>(sq);
+        case 3:
+            return default_value<piece_t::white_rook>(sq);
+        case 4:
+            return default_value<piece_t::white_queen>(sq);
+        default:
+            return default_value<piece_t::white_king>(sq);
+    }
+}
+
+// A network whose output is the side to move's material and piece square values less the
+// opponent's, averaging the midgame and endgame tables and rounding each piece to
+// default_value_scale centipawns. Every hidden unit sums the values of one group of pieces, the
+// hidden layer passes the side to move's units straight through and the output weighs them up
+auto build_default_network() -> vector<std::byte>
+{
+    using namespace nnue;
+    const network_header_t header{.magic = network_magic,
+                                  .king_buckets = king_buckets,
+                                  .features = features,
+                                  .hidden = hidden,
+                                  .l1_size = l1_size,
+                                  .output_divisor = 1,
+                                  .reserved = 0};
+    vector<int16_t> ft_biases(hidden, 0);
+    vector<int16_t> ft_weights(features * hidden, 0);
+    vector<int32_t> l1_biases(l1_size, 0);
+    vector<int8_t> l1_weights(l1_size * 2 * hidden, 0);
+    vector<int8_t> output_weights(l1_size, 0);
+
+    const size_t king_unit = default_units_per_side - 1;
+    ft_biases[king_unit] = default_king_bias;
+    ft_biases[default_units_per_side + king_unit] = default_king_bias;
+    for (size_t bucket = 0; bucket < king_buckets; bucket++)
+    {
+        for (size_t piece = 0; piece < piece_kinds; piece++)
+        {
+            const size_t kind = piece % 6;
+            // the tables are the same for both colours once flipped, so white's serve for both
+            for (int sq = 0; sq < static_cast<int>(squares); sq++)
+            {
+                const size_t pawn_half = sq % 8 >= 4 ? 1 : 0;
+                const size_t unit = (piece < 6 ? 0 : default_units_per_side) +
+                                    (kind == 0 ? pawn_half : kind + 1);
+                // the opponent's pieces are seen from the far end of the board
+                const double value = white_piece_value(kind, piece < 6 ? sq : sq ^ 56);
+                ft_weights[(((bucket * piece_kinds) + piece) * squares + sq) * hidden + unit] =
+                    static_cast<int16_t>(lround(value / default_value_scale));
+            }
+        }
+    }
+    for (size_t unit = 0; unit < 2 * default_units_per_side; unit++)
+    {
+        l1_weights[unit * 2 * hidden + unit] = 1 << l1_shift;
+        output_weights[unit] = static_cast<int8_t>(unit < default_units_per_side
+                                                       ? default_value_scale
+                                                       : -default_value_scale);
+    }
+
+    vector<std::byte> bytes;
+    bytes.reserve(network_bytes);
+    append(bytes, span<const network_header_t>(&header, 1));
+    append(bytes, span<const int16_t>(ft_biases));
+    append(bytes, span<const int16_t>(ft_weights));
+    append(bytes, span<const int32_t>(l1_biases));
+    append(bytes, span<const int8_t>(l1_weights));
+    const int32_t output_bias = 0;
+    append(bytes, span<const int32_t>(&output_bias, 1));
+    append(bytes, span<const int8_t>(output_weights));
+    return bytes;
+}
+
+struct current_network_t
+{
+    nnue::network_t net;
+    // null while the built in network is in use
+    unique_ptr<MappedFile> file;
+};
+
+auto current() -> current_network_t &
+{
+    static current_network_t network{.net = *parse(nnue::default_network_bytes()), .file = nullptr};
+    return network;
+}
+
+// clips the accumulator to [0, activation_max] as bytes
+void clip(const array<int16_t, nnue::hidden> &values, uint8_t *out)
+{
+#ifdef __AVX2__
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(nnue::activation_max);
+    for (size_t idx = 0; idx < nnue::hidden; idx += 32)
+    {
+        const __m256i low = _mm256_min_epi16(
+            _mm256_max_epi16(
+                _mm256_load_si256(reinterpret_cast<const __m256i *>(&values[idx])), zero),
+            max);
+        const __m256i high = _mm256_min_epi16(
+            _mm256_max_epi16(
+                _mm256_load_si256(reinterpret_cast<const __m256i *>(&values[idx + 16])), zero),
+            max);
+        // packus interleaves the 128 bit halves of its inputs, the permute puts them back in order
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(out + idx),
+            _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0b11011000));
+    }
+#else
+    for (size_t idx = 0; idx < nnue::hidden; idx++)
+    {
+        out[idx] = static_cast<uint8_t>(clamp<int>(values[idx], 0, nnue::activation_max));
+    }
+#endif
+}
+
+// the dot product of inputs clipped to [0, activation_max] and int8 weights
+auto dot(const uint8_t *inputs, const int8_t *weights, const size_t count) -> int32_t
+{
+#ifdef __AVX2__
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for (size_t idx = 0; idx < count; idx += 32)
+    {
+        // the inputs are at most activation_max, so the pairs maddubs adds can't saturate
+        const __m256i products = _mm256_maddubs_epi16(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inputs + idx)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + idx)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+    }
+    const __m128i half =
+        _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    const __m128i quarter = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0b01001110));
+    return _mm_cvtsi128_si32(_mm_add_epi32(quarter, _mm_shuffle_epi32(quarter, 0b10110001)));
+#else
+    int32_t sum = 0;
+    for (size_t idx = 0; idx < count; idx++)
+    {
+        sum += static_cast<int32_t>(inputs[idx]) * weights[idx];
+    }
+    return sum;
+#endif
+}
+
+template <bool Add>
+void update(array<int16_t, nnue::hidden> &values, const size_t feature)
+{
+    const int16_t *row = current().net.ft_weights.data() + (feature * nnue::hidden);
+#ifdef __AVX2__
+    for (size_t idx = 0; idx < nnue::hidden; idx += 16)
+    {
+        auto *dst = reinterpret_cast<__m256i *>(&values[idx]);
+        const __m256i weights = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + idx));
+        _mm256_store_si256(dst, Add ? _mm256_add_epi16(_mm256_load_si256(dst), weights)
+                                    : _mm256_sub_epi16(_mm256_load_si256(dst), weights));
+    }
+#else
+    for (size_t idx = 0; idx < nnue::hidden; idx++)
+    {
+        values[idx] = static_cast<int16_t>(Add ? values[idx] + row[idx] : values[idx] - row[idx]);
+    }
+#endif
+}
+}  // namespace
+
+auto nnue::default_network_bytes() -> span<const std::byte>
+{
+    static const vector<std::byte> bytes = build_default_network();
+    return bytes;
+}
+
+auto nnue::load(const string &filename) -> bool
+{
+    auto file = make_unique<MappedFile>(filename);
+    const optional<network_t> net = parse(file->bytes());
+    if (!net)
+    {
+        return false;
+    }
+    current() = {.net = *net, .file = std::move(file)};
+    return true;
+}
+
+auto nnue::network() -> const network_t & { return current().net; }
+
+void nnue::add_feature(array<int16_t, hidden> &values, const size_t feature)
+{
+    update<true>(values, feature);
+}
+
+void nnue::sub_feature(array<int16_t, hidden> &values, const size_t feature)
+{
+    update<false>(values, feature);
+}
+
+void nnue::reset(array<int16_t, hidden> &values)
+{
+    copy(current().net.ft_biases.begin(), current().net.ft_biases.end(), values.begin());
+}
+
+auto nnue::evaluate(const BitBoard &board) -> int
+{
+    return evaluate(board.accumulator(), board.whites_turn());
+}
+
+auto nnue::evaluate(const accumulator_t &accumulator, const bool white_to_move) -> int
+{
+    const network_t &net = current().net;
+    const size_t us = white_to_move ? 0 : 1;
+
+    alignas(32) array<uint8_t, 2 * hidden> inputs{};
+    clip(accumulator.values[us], inputs.data());
+    clip(accumulator.values[us ^ 1], inputs.data() + hidden);
+
+    int32_t output = net.output_bias[0];
+    for (size_t unit = 0; unit < l1_size; unit++)
+    {
+        const int32_t sum = net.l1_biases[unit] +
+                            dot(inputs.data(), net.l1_weights.data() + (unit * 2 * hidden),
+                                2 * hidden);
+        output += net.output_weights[unit] * clamp(sum >> l1_shift, 0, activation_max);
+    }
+    const int eval = output / net.header.output_divisor;
+    return us == 0 ? eval : -eval;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+class BitBoard;
+
+// Efficiently updatable neural network evaluation.
+//
+// Each side sees the board from its own end through HalfKA style features, one per piece, square
+// and bucket of its own king's square, with the piece's colour taken relative to that side. The
+// feature transformer sums the rows of the active features into an int16 accumulator per side,
+// which BitBoard keeps up to date as pieces move and rebuilds when a king changes bucket. The
+// clipped accumulators, the side to move's first, then go through an int8 hidden layer and an
+// int8 output layer. The network is read from a file laid out as network_header_t followed by the
+// layers in the order network_t lists them, which is memory mapped rather than copied, and falls
+// back to a built in network that reproduces the material and piece square values
+namespace nnue
+{
+static_assert(std::endian::native == std::endian::little, "network files are little endian");
+
+inline constexpr size_t king_buckets = 4;
+inline constexpr size_t piece_kinds = 12;
+inline constexpr size_t squares = 64;
+inline constexpr size_t features = king_buckets * piece_kinds * squares;
+inline constexpr size_t hidden = 128;
+inline constexpr size_t l1_size = 16;
+// the accumulator and hidden layer outputs are clipped to [0, activation_max]
+inline constexpr int activation_max = 127;
+// the hidden layer's weights are scaled up by 1 << l1_shift
+inline constexpr int l1_shift = 6;
+
+// mapped at startup when it's in the working directory
+inline constexpr const char *default_network_file = "elwellbot.nnue";
+
+inline constexpr std::array<char, 8> network_magic = {'E', 'L', 'W', 'N', 'N', 'U', 'E', '1'};
+
+struct network_header_t
+{
+    std::array<char, 8> magic;
+    uint32_t king_buckets;
+    uint32_t features;
+    uint32_t hidden;
+    uint32_t l1_size;
+    // the output layer's sum divided by this is the evaluation in centipawns
+    int32_t output_divisor;
+    uint32_t reserved;
+};
+
+// views of the weights, either into a mapped file or the built in network
+struct network_t
+{
+    network_header_t header;
+    std::span<const int16_t> ft_biases;
+    // features rows of hidden weights
+    std::span<const int16_t> ft_weights;
+    std::span<const int32_t> l1_biases;
+    // l1_size rows of 2 * hidden weights
+    std::span<const int8_t> l1_weights;
+    std::span<const int32_t> output_bias;
+    std::span<const int8_t> output_weights;
+};
+
+// the size of a network file
+inline constexpr size_t network_bytes =
+    sizeof(network_header_t) + (hidden * sizeof(int16_t)) + (features * hidden * sizeof(int16_t)) +
+    (l1_size * sizeof(int32_t)) + (l1_size * 2 * hidden) + sizeof(int32_t) + l1_size;
+
+// one accumulator per side, indexed by side_t, and the king bucket each was built for
+struct accumulator_t
+{
+    alignas(32) std::array<std::array<int16_t, hidden>, 2> values;
+    std::array<uint8_t, 2> buckets;
+};
+
+// Only change this between searches, BitBoard only keeps its accumulators while it is set and
+// boards built before it was set need refresh_accumulators
+inline bool enabled = false;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+// king_sq and sq as seen from perspective's end of the board
+constexpr auto relative_square(const size_t perspective, const int sq) -> int
+{
+    return perspective == 0 ? sq : sq ^ 56;
+}
+
+// the back two ranks split into the king's and queen's side, and everywhere further up likewise
+constexpr auto king_bucket(const size_t perspective, const int king_sq) -> uint8_t
+{
+    const int sq = relative_square(perspective, king_sq);
+    return static_cast<uint8_t>((sq >= 16 ? 2 : 0) + (sq % 8 >= 4 ? 1 : 0));
+}
+
+// piece is a piece_t from white_pawn to black_king
+constexpr auto feature(const size_t perspective, const size_t piece, const int sq,
+                       const uint8_t bucket) -> size_t
+{
+    const size_t colour = piece / 6;
+    const size_t relative_piece = (piece % 6) + (colour == perspective ? 0 : 6);
+    return (((bucket * piece_kinds) + relative_piece) * squares) +
+           static_cast<size_t>(relative_square(perspective, sq));
+}
+
+// maps filename in place of the current network, keeping the current one if it can't be read
+auto load(const std::string &filename) -> bool;
+// the mapped file if one was loaded, otherwise the built in network
+auto network() -> const network_t &;
+// the built in network as the bytes of a network file
+auto default_network_bytes() -> std::span<const std::byte>;
+
+void add_feature(std::array<int16_t, hidden> &values, size_t feature);
+void sub_feature(std::array<int16_t, hidden> &values, size_t feature);
+void reset(std::array<int16_t, hidden> &values);
+
+// the position's evaluation from white's side, read off the board's accumulators
+auto evaluate(const BitBoard &board) -> int;
+auto evaluate(const accumulator_t &accumulator, bool white_to_move) -> int;
+}  // namespace nnue
@@ -0,0 +1,165 @@
+#include "pawns.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "attacks.h"
+#include "bitboard.h"
+#include "bitscan.h"
+#include "data.h"
+
+using namespace std;
+
+namespace
+{
+constexpr int doubled_midgame = -10;
+constexpr int doubled_endgame = -20;
+constexpr int isolated_midgame = -10;
+constexpr int isolated_endgame = -15;
+constexpr int backward_midgame = -8;
+constexpr int backward_endgame = -10;
+// by rank counted from the pawn's own side, on top of the piece square tables' advancement bonus
+constexpr array<int, 8> passed_midgame = {0, 5, 10, 15, 25, 40, 60, 0};
+constexpr array<int, 8> passed_endgame = {0, 10, 15, 25, 45, 70, 110, 0};
+// per shield file, for a pawn still on its starting rank, one square up, or no pawn on either
+constexpr int shield_near = 12;
+constexpr int shield_far = 6;
+constexpr int shield_missing = -10;
+
+static_assert(pawns::max_midgame_without_passers ==
+              (-8 * (doubled_midgame + isolated_midgame)) + (3 * (shield_near - shield_missing)));
+
+// the files either side of the king's wing and the queen's wing, h file first like masks::files
+constexpr array<array<size_t, 3>, 2> shield_files = {{{0, 1, 2}, {5, 6, 7}}};
+
+// every square ahead of squares up to the far edge for Side, not including squares themselves
+template <side_t Side>
+constexpr auto front_span(uint64_t squares) -> uint64_t
+{
+    using traits = side_traits<Side>;
+    squares = traits::forward(squares, 8);
+    squares |= traits::forward(squares, 8);
+    squares |= traits::forward(squares, 16);
+    squares |= traits::forward(squares, 32);
+    return squares;
+}
+
+// the squares one file either side of squares
+constexpr auto adjacent_files(const uint64_t squares) -> uint64_t
+{
+    return ((squares << 1) & ~masks::file_h) | ((squares >> 1) & ~masks::file_a);
+}
+
+template <side_t Side>
+void add_pawn_terms(const uint64_t own, const uint64_t enemy, const int sign,
+                    pawns::entry_t &entry)
+{
+    using traits = side_traits<Side>;
+    const uint64_t enemy_attacks = pawn_attacks<~Side>(enemy);
+    int midgame = 0;
+    int endgame = 0;
+    for (const auto bit : BitScan(own))
+    {
+        const int sq = __builtin_ctzll(bit);
+        const int rank = Side == side_t::white ? sq / 8 : 7 - (sq / 8);
+        const uint64_t ahead = front_span<Side>(bit);
+        const uint64_t neighbours = adjacent_files(masks::files[sq % 8]) & own;
+
+        if ((ahead & own) != 0)
+        {
+            // counted on the pawns behind, which are the ones blocked
+            midgame += doubled_midgame;
+            endgame += doubled_endgame;
+        }
+        else if (((ahead | adjacent_files(ahead)) & enemy) == 0)
+        {
+            midgame += passed_midgame[rank];
+            endgame += passed_endgame[rank];
+        }
+
+        if (neighbours == 0)
+        {
+            midgame += isolated_midgame;
+            endgame += isolated_endgame;
+        }
+        else if ((neighbours & (adjacent_files(bit) | front_span<~Side>(adjacent_files(bit)))) ==
+                     0 &&
+                 (traits::forward(bit, 8) & enemy_attacks) != 0)
+        {
+            // nothing beside or behind it can come up to defend its way forward
+            midgame += backward_midgame;
+            endgame += backward_endgame;
+        }
+    }
+    entry.midgame = static_cast<int16_t>(entry.midgame + (sign * midgame));
+    entry.endgame = static_cast<int16_t>(entry.endgame + (sign * endgame));
+
+    const uint64_t near = traits::double_push_rank;
+    const uint64_t far = traits::forward(near, 8);
+    for (size_t wing = 0; wing < 2; wing++)
+    {
+        int shield = 0;
+        for (const size_t file : shield_files[wing])
+        {
+            const uint64_t pawns_on_file = own & masks::files[file];
+            shield += (pawns_on_file & near) != 0  ? shield_near
+                      : (pawns_on_file & far) != 0 ? shield_far
+                                                   : shield_missing;
+        }
+        entry.shields[static_cast<size_t>(Side)][wing] = static_cast<int16_t>(shield);
+    }
+}
+
+// the shield of the wing king_sq is on, nothing for a king on the d or e file
+auto wing_shield(const pawns::entry_t &entry, const side_t side, const int king_sq) -> int
+{
+    const int file = king_sq % 8;
+    if (file >= 3 && file <= 4)
+    {
+        return 0;
+    }
+    return entry.shields[static_cast<size_t>(side)][file < 3 ? 0 : 1];
+}
+}  // namespace
+
+auto pawns::compute(const uint64_t white_pawns, const uint64_t black_pawns) -> entry_t
+{
+    entry_t entry{};
+    add_pawn_terms<side_t::white>(white_pawns, black_pawns, 1, entry);
+    add_pawn_terms<side_t::black>(black_pawns, white_pawns, -1, entry);
+    return entry;
+}
+
+auto pawns::compute(const BitBoard &board) -> entry_t
+{
+    return compute(board[piece_t::white_pawn], board[piece_t::black_pawn]);
+}
+
+auto pawns::has_passers(const uint64_t white_pawns, const uint64_t black_pawns) -> bool
+{
+    const uint64_t white_stops = front_span<side_t::black>(black_pawns);
+    const uint64_t black_stops = front_span<side_t::white>(white_pawns);
+    return (white_pawns & ~(white_stops | adjacent_files(white_stops))) != 0 ||
+           (black_pawns & ~(black_stops | adjacent_files(black_stops))) != 0;
+}
+
+auto pawns::king_shields(const entry_t &entry, const BitBoard &board) -> int
+{
+    return king_shields(entry, __builtin_ctzll(board[piece_t::white_king]),
+                        __builtin_ctzll(board[piece_t::black_king]));
+}
+
+auto pawns::king_shields(const entry_t &entry, const int white_king, const int black_king) -> int
+{
+    return wing_shield(entry, side_t::white, white_king) -
+           wing_shield(entry, side_t::black, black_king);
+}
+
+auto pawns::table() -> PawnTable &
+{
+    // a position without pawns has a pawn hash of zero, so that's what every slot starts out
+    // holding
+    thread_local PawnTable pawn_table(compute(0, 0));
+    return pawn_table;
+}
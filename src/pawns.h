@@ -0,0 +1,47 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "bitboard.h"
+#include "direct_table.h"
+
+// Pawn structure terms: passed, isolated, doubled and backward pawns, and the shield of pawns in
+// front of a king castled to either wing. They only depend on the pawns, so each thread caches
+// them in a PawnTable keyed by BitBoard::pawn_hash and only works them out again when a pawn has
+// moved or been taken
+namespace pawns
+{
+struct entry_t
+{
+    uint64_t key;
+    // white's terms less black's, leaving out the shields
+    int16_t midgame;
+    int16_t endgame;
+    // each side's shield for its king on the king's side and on the queen's side, the king's
+    // position isn't part of the key so the king picks one when evaluating
+    std::array<std::array<int16_t, 2>, 2> shields;
+};
+
+// the terms for the pawns, without a key
+auto compute(uint64_t white_pawns, uint64_t black_pawns) -> entry_t;
+// the terms for board's pawns, without a key
+auto compute(const BitBoard &board) -> entry_t;
+
+// whether either side has a pawn with no enemy pawn ahead of it on its own file or either side,
+// which is every passer compute counts and any pawns of its own behind it
+auto has_passers(uint64_t white_pawns, uint64_t black_pawns) -> bool;
+
+// The most the midgame terms can differ between the sides when neither has a passer: every pawn
+// of one side doubled and isolated against none of the other's, and a full shield against an
+// empty one
+inline constexpr int max_midgame_without_passers = 226;
+
+// the shield in front of each king from entry, white's less black's, midgame only
+auto king_shields(const entry_t &entry, const BitBoard &board) -> int;
+auto king_shields(const entry_t &entry, int white_king, int black_king) -> int;
+
+using PawnTable = DirectTable<entry_t, 1 << 14, &BitBoard::pawn_hash, compute>;
+
+// the calling thread's table
+auto table() -> PawnTable &;
+}  // namespace pawns
@@ -0,0 +1,164 @@
+#include "perf_counters.h"
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <string>
+#include <string_view>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+#ifdef __linux__
+struct event_config_t
+{
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr auto cache_miss_config(const uint64_t cache) -> uint64_t
+{
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+constexpr array<event_config_t, PerfCounters::counter_count> event_configs = {{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, cache_miss_config(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, cache_miss_config(PERF_COUNT_HW_CACHE_LL)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+}};
+
+// user space only, which is all perf_event_paranoid lets an unprivileged process count anyway
+auto open_counter(const event_config_t &event) -> int
+{
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+}  // namespace
+
+PerfCounters::PerfCounters()
+{
+    m_fds.fill(-1);
+#ifdef __linux__
+    for (size_t counter = 0; counter < counter_count; counter++)
+    {
+        m_fds[counter] = open_counter(event_configs[counter]);
+        if (m_fds[counter] < 0 && m_error.empty())
+        {
+            m_error = format("{}: {}", names[counter], strerror(errno));
+        }
+    }
+#else
+    m_error = "hardware counters are only read on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (const int fd : m_fds)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+#endif
+}
+
+auto PerfCounters::available() const -> bool
+{
+    for (size_t counter = 0; counter < counter_count; counter++)
+    {
+        if (available(static_cast<counter_t>(counter)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+auto PerfCounters::available(const counter_t counter) const -> bool { return m_fds[counter] >= 0; }
+
+void PerfCounters::start()
+{
+#ifdef __linux__
+    for (const int fd : m_fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+auto PerfCounters::stop() -> values_t
+{
+    values_t values{};
+#ifdef __linux__
+    for (const int fd : m_fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (size_t counter = 0; counter < counter_count; counter++)
+    {
+        // the count, then the time the counter was enabled and the time it was actually counting
+        array<uint64_t, 3> data{};
+        if (m_fds[counter] < 0 || read(m_fds[counter], data.data(), sizeof(data)) !=
+                                      static_cast<ssize_t>(sizeof(data)))
+        {
+            continue;
+        }
+        values[counter] = data[2] == 0 ? 0
+                                       : static_cast<uint64_t>(static_cast<double>(data[0]) *
+                                                               static_cast<double>(data[1]) /
+                                                               static_cast<double>(data[2]));
+    }
+#endif
+    return values;
+}
+
+auto PerfCounters::summary(const values_t &values, const uint64_t ops,
+                           const string_view unit) const -> string
+{
+    string out;
+    if (available(cycles) && available(instructions) && values[cycles] > 0)
+    {
+        out += format("IPC {:.2f}", static_cast<double>(values[instructions]) /
+                                        static_cast<double>(values[cycles]));
+    }
+    for (size_t counter = 0; counter < counter_count; counter++)
+    {
+        if (available(static_cast<counter_t>(counter)) && ops > 0)
+        {
+            out += format("{}{}/{} {:.3f}", out.empty() ? "" : " | ", names[counter], unit,
+                          static_cast<double>(values[counter]) / static_cast<double>(ops));
+        }
+    }
+    return out;
+}
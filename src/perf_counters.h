@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Hardware counters for the calling thread, read through perf_event_open on Linux. Counters the
+// kernel or the container won't give us are left closed and read as zero, so callers only need to
+// check available() before reporting. On other platforms nothing is ever available
+class PerfCounters
+{
+   public:
+    enum counter_t : uint8_t
+    {
+        cycles,
+        instructions,
+        l1d_misses,
+        llc_misses,
+        branch_misses,
+        counter_count
+    };
+    using values_t = std::array<uint64_t, counter_count>;
+
+    static constexpr std::array<std::string_view, counter_count> names = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    auto operator=(const PerfCounters &) -> PerfCounters & = delete;
+    PerfCounters(PerfCounters &&) = delete;
+    auto operator=(PerfCounters &&) -> PerfCounters & = delete;
+
+    [[nodiscard]] auto available() const -> bool;
+    [[nodiscard]] auto available(counter_t counter) const -> bool;
+    // why the first counter that failed to open couldn't be, empty when they all opened
+    [[nodiscard]] auto error() const -> const std::string & { return m_error; }
+
+    // zeroes and starts every open counter
+    void start();
+    // stops the counters and returns what they counted since start, scaled up when the kernel had
+    // to multiplex them
+    auto stop() -> values_t;
+
+    // IPC and each counter per unit of work, leaving out what isn't available
+    [[nodiscard]] auto summary(const values_t &values, uint64_t ops, std::string_view unit) const
+        -> std::string;
+
+   private:
+    std::array<int, counter_count> m_fds;
+    std::string m_error;
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Perft node counts shared between threads without locks. Every entry keeps its count next to
+// the count xor'd with the key, so a half written entry from two threads storing at once fails the
+// check on probe and is treated as a miss rather than returning another position's count
+class PerftTable
+{
+   private:
+    struct entry_t
+    {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> nodes;
+    };
+
+    std::unique_ptr<entry_t[]> m_entries;  // NOLINT(cppcoreguidelines-avoid-c-arrays)
+    uint64_t m_mask;
+
+    // the same position at another depth is a different entry
+    static constexpr auto key(uint64_t hash, int depth) -> uint64_t
+    {
+        return hash ^ (static_cast<uint64_t>(depth) * 0x9E3779B97F4A7C15ULL);
+    }
+
+   public:
+    explicit PerftTable(size_t size_mb)
+        : m_mask(std::bit_floor(std::max<size_t>(size_mb * 1024 * 1024 / sizeof(entry_t), 1)) - 1)
+    {
+        m_entries = std::make_unique<entry_t[]>(m_mask + 1);  // NOLINT
+    }
+
+    [[nodiscard]] auto probe(uint64_t hash, int depth, uint64_t &nodes) const -> bool
+    {
+        const uint64_t entry_key = key(hash, depth);
+        const entry_t &entry = m_entries[entry_key & m_mask];
+        const uint64_t stored = entry.nodes.load(std::memory_order_relaxed);
+        if ((entry.check.load(std::memory_order_relaxed) ^ stored) != entry_key)
+        {
+            return false;
+        }
+        nodes = stored;
+        return true;
+    }
+
+    void store(uint64_t hash, int depth, uint64_t nodes)
+    {
+        const uint64_t entry_key = key(hash, depth);
+        entry_t &entry = m_entries[entry_key & m_mask];
+        entry.check.store(entry_key ^ nodes, std::memory_order_relaxed);
+        entry.nodes.store(nodes, std::memory_order_relaxed);
+    }
+};
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <limits>
 #include <memory>
 #include <utility>
@@ -7,8 +8,12 @@
 #include "bitboard.h"
 #include "engine.h"
 #include "eval.h"
+#include "eval_cache.h"
+#include "material.h"
 #include "move.h"
 #include "move_gen.h"
+#include "pawns.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -43,59 +48,111 @@ constexpr auto no_moves_eval(const MoveGen& move_gen, int iter) noexcept -> int
                    : 0;
     }
 }
+
+void count_cutoff([[maybe_unused]] search_stats_t& stats, [[maybe_unused]] bool first_move)
+{
+    if constexpr (search_stats_enabled)
+    {
+        stats.cutoffs++;
+        stats.first_move_cutoffs += static_cast<uint64_t>(first_move);
+    }
+}
 }  // namespace
 
 template <side_t Side>
 void Engine::search_async(pair<int, unique_ptr<const result_t>>& result, BitBoard board,
-                          atomic_bool& b_stop)
+                          atomic_bool& b_stop, search_stats_t& stats, bool report)
 {
+    const auto start = chrono::steady_clock::now();
     pair<int, unique_ptr<const result_t>> temp_result = {init_eval<Side>, nullptr};
-    for (int depth = 1; !b_stop; depth++)
+    // the counters as of the last finished iteration, the one cut short would skew them
+    search_stats_t completed_stats;
+    int completed = 0;
+    reset_thread_tables();
+    UndoStack undo;
+    // the search makes one move a ply, so the deepest iteration fills the undo stack exactly
+    for (int depth = 1; !b_stop && depth <= UndoStack::max_ply; depth++)
     {
-        temp_result = search<Side>(board, depth, numeric_limits<int>::min(),
-                                   numeric_limits<int>::max(), b_stop);
+        trace::begin("iteration", depth);
+        temp_result = search<Side>(board, undo, depth, numeric_limits<int>::min(),
+                                   numeric_limits<int>::max(), b_stop, stats);
+        trace::end("iteration", depth);
 
         if (!b_stop && temp_result.second)
         {
             result = std::move(temp_result);
+            completed = depth;
+            collect_table_stats(stats);
+            completed_stats = stats;
+            if (report)
+            {
+                print_info(board, depth, result.first, stats, chrono::steady_clock::now() - start,
+                           result.second.get());
+            }
         }
     }
+    if (report)
+    {
+        print_stats(completed_stats, completed);
+    }
 }
 
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
 template <side_t Side>
-auto Engine::search(BitBoard& board, int iter, int alpha, int beta, atomic_bool& b_stop)
-    -> pair<int, unique_ptr<result_t>>
+auto Engine::search(BitBoard& board, UndoStack& undo, int iter, int alpha, int beta,
+                    atomic_bool& b_stop, search_stats_t& stats) -> pair<int, unique_ptr<result_t>>
 {
     // instantly stop searching and cleanup
     if (b_stop)
     {
         return {init_eval<~Side>, nullptr};
     }
+    stats.nodes++;
     // if end of iteration, return evaluation of board
     if (iter == 0)
     {
-        return {evaluate(board), nullptr};
+        if constexpr (search_stats_enabled)
+        {
+            stats.leaf_evals++;
+        }
+        int eval = 0;
+        if (!eval_cache::table().probe(board, eval))
+        {
+            eval = evaluate(board, alpha, beta);
+            // a lazy evaluation is only a bound, and is always beyond the margin
+            if (eval + lazy_eval_margin >= alpha && eval - lazy_eval_margin <= beta)
+            {
+                eval_cache::table().store(board, eval);
+            }
+        }
+        return {eval, nullptr};
     }
 
     auto p_result = make_unique<result_t>();
     auto move_gen = MoveGen(board);
     const Move* p_best_move = nullptr;
     int best_eval = init_eval<Side>;
+    [[maybe_unused]] bool first_move = true;
     move_gen.gen<Side>();
+    move_gen.demote_losing_captures();
     for (const auto& move : move_gen)
     {
-        board.apply_move(move);
+        board.make_move(move, undo);
 
         // check if move leaves king in check
         if (move_gen.is_king_in_check<Side>())
         {
-            board.apply_move(move);
+            if constexpr (search_stats_enabled)
+            {
+                stats.illegal_moves++;
+            }
+            board.unmake_move(move, undo);
             continue;
         }
 
-        auto [eval, child_result] = search<~Side>(board, iter - 1, alpha, beta, b_stop);
-        board.apply_move(move);
+        auto [eval, child_result] =
+            search<~Side>(board, undo, iter - 1, alpha, beta, b_stop, stats);
+        board.unmake_move(move, undo);
 
         if constexpr (Side == side_t::white)
         {
@@ -108,6 +165,7 @@ auto Engine::search(BitBoard& board, int iter, int alpha, int beta, atomic_bool&
             alpha = max(alpha, best_eval);
             if (alpha >= beta)
             {
+                count_cutoff(stats, first_move);
                 break;
             }
         }
@@ -122,9 +180,11 @@ auto Engine::search(BitBoard& board, int iter, int alpha, int beta, atomic_bool&
             beta = min(beta, best_eval);
             if (beta <= alpha)
             {
+                count_cutoff(stats, first_move);
                 break;
             }
         }
+        first_move = false;
     }
     if (!p_best_move)
     {
@@ -135,10 +195,14 @@ auto Engine::search(BitBoard& board, int iter, int alpha, int beta, atomic_bool&
 }
 
 template void Engine::search_async<side_t::white>(pair<int, unique_ptr<const result_t>>& result,
-                                                  BitBoard board, atomic_bool& b_stop);
+                                                  BitBoard board, atomic_bool& b_stop,
+                                                  search_stats_t& stats, bool report);
 template void Engine::search_async<side_t::black>(pair<int, unique_ptr<const result_t>>& result,
-                                                  BitBoard board, atomic_bool& b_stop);
-template auto Engine::search<side_t::white>(BitBoard&, int, int, int, atomic_bool& b_stop)
+                                                  BitBoard board, atomic_bool& b_stop,
+                                                  search_stats_t& stats, bool report);
+template auto Engine::search<side_t::white>(BitBoard&, UndoStack&, int, int, int,
+                                            atomic_bool& b_stop, search_stats_t& stats)
     -> std::pair<int, std::unique_ptr<result_t>>;
-template auto Engine::search<side_t::black>(BitBoard&, int, int, int, atomic_bool& b_stop)
+template auto Engine::search<side_t::black>(BitBoard&, UndoStack&, int, int, int,
+                                            atomic_bool& b_stop, search_stats_t& stats)
     -> std::pair<int, std::unique_ptr<result_t>>;
\ No newline at end of file
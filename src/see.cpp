@@ -0,0 +1,211 @@
+#include "see.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "attacks.h"
+#include "bitboard.h"
+#include "move.h"
+
+using namespace std;
+
+namespace
+{
+constexpr size_t piece_kinds = see_piece_values.size();
+
+// the white piece of the same kind
+constexpr auto kind_of(const piece_t piece) -> piece_t
+{
+    return static_cast<piece_t>(static_cast<size_t>(piece) % piece_kinds);
+}
+
+constexpr auto value_of(const piece_t piece) -> int
+{
+    return see_piece_values[static_cast<size_t>(kind_of(piece))];
+}
+
+// the position on the target square once move has been played
+struct exchange_t
+{
+    uint64_t to;
+    uint64_t occupied;
+    // material won by the move itself and the piece left standing on the target square
+    int gain;
+    piece_t on_square;
+};
+
+auto first_exchange(const BitBoard &board, const Move &move) -> exchange_t
+{
+    const move_squares_t squares = move.squares(board);
+    exchange_t exchange{.to = squares.to,
+                        .occupied = (board[piece_t::all_pcs] & ~squares.from & ~squares.captured) |
+                                    squares.to,
+                        .gain = 0,
+                        .on_square = move.pc1};
+    switch (move.type)
+    {
+        case movType::CAPTURE:
+            exchange.gain = value_of(move.pc2);
+            break;
+        case movType::PROMOTE:
+            exchange.gain = value_of(move.pc2) - value_of(move.pc1);
+            exchange.on_square = move.pc2;
+            break;
+        case movType::CAPTURE_PROMOTE:
+            exchange.gain = value_of(move.pc2) + value_of(move.pc3) - value_of(move.pc1);
+            exchange.on_square = move.pc3;
+            break;
+        default:
+            break;
+    }
+    return exchange;
+}
+
+// the least valuable of side's attackers, or no_piece when it has none
+auto least_valuable(const BitBoard &board, const uint64_t attackers, const side_t side) -> piece_t
+{
+    const size_t first = side == side_t::white ? 0 : piece_kinds;
+    for (size_t piece = first; piece < first + piece_kinds; piece++)
+    {
+        if ((attackers & board[static_cast<piece_t>(piece)]) != 0)
+        {
+            return static_cast<piece_t>(piece);
+        }
+    }
+    return no_piece;
+}
+
+// Takes the attacker off occupied and adds the sliders it was screening, the pieces that move
+// onto the target square only ever uncover sliders lined up behind them through the target
+auto remove_attacker(const BitBoard &board, const piece_t attacker, const uint64_t to,
+                     uint64_t &occupied, uint64_t attackers) -> uint64_t
+{
+    occupied ^= attackers & board[attacker] & -(attackers & board[attacker]);
+    const piece_t kind = kind_of(attacker);
+    if (kind == piece_t::white_pawn || kind == piece_t::white_bishop ||
+        kind == piece_t::white_queen)
+    {
+        attackers |= bishop_attacks(to, occupied) &
+                     (board[piece_t::white_bishop] | board[piece_t::white_queen] |
+                      board[piece_t::black_bishop] | board[piece_t::black_queen]);
+    }
+    if (kind == piece_t::white_rook || kind == piece_t::white_queen)
+    {
+        attackers |= rook_attacks(to, occupied) &
+                     (board[piece_t::white_rook] | board[piece_t::white_queen] |
+                      board[piece_t::black_rook] | board[piece_t::black_queen]);
+    }
+    return attackers & occupied;
+}
+
+auto side_pcs_of(const side_t side) -> piece_t
+{
+    return side == side_t::white ? piece_t::white_pcs : piece_t::black_pcs;
+}
+
+// What side wins on top of the capture itself when its least valuable attacker is a pawn taking
+// onto the last rank, which always promotes to a queen. Only one side's pawns can ever reach a
+// given back rank square, so any pawn among the attackers is on its way to promoting
+auto promotion_gain(const BitBoard &board, const uint64_t to, const uint64_t attackers,
+                    const side_t side) -> int
+{
+    constexpr uint64_t back_ranks = 0xff000000000000ffULL;
+    const piece_t pawn = side == side_t::white ? piece_t::white_pawn : piece_t::black_pawn;
+    return (to & back_ranks) != 0 && (attackers & board[pawn]) != 0
+               ? value_of(piece_t::white_queen) - value_of(piece_t::white_pawn)
+               : 0;
+}
+}  // namespace
+
+auto see(const BitBoard &board, const Move &move) -> int
+{
+    if (move.type == movType::CASTLE_kingside || move.type == movType::CASTLE_queenside)
+    {
+        return 0;
+    }
+    exchange_t exchange = first_exchange(board, move);
+    const int sq = __builtin_ctzll(exchange.to);
+    uint64_t attackers = board.attackers_to(sq, exchange.occupied) & exchange.occupied;
+    side_t side = board.whites_turn() ? side_t::black : side_t::white;
+
+    // gains[depth] is what the side making capture depth wins if the exchange stops there. It is
+    // filled in before knowing whether that capture can be made, the last entry is left out
+    array<int, BitBoard::num_squares> gains{};
+    gains[0] = exchange.gain;
+    int on_square = value_of(exchange.on_square);
+    size_t depth = 0;
+    for (;;)
+    {
+        depth++;
+        gains[depth] = on_square - gains[depth - 1];
+        const piece_t attacker = least_valuable(board, attackers, side);
+        if (attacker == no_piece || (kind_of(attacker) == piece_t::white_king &&
+                                     (attackers & board[side_pcs_of(~side)]) != 0))
+        {
+            break;
+        }
+        const int promotion = promotion_gain(board, exchange.to, attackers, side);
+        gains[depth] += promotion;
+        attackers = remove_attacker(board, attacker, exchange.to, exchange.occupied, attackers);
+        on_square = value_of(attacker) + promotion;
+        side = ~side;
+    }
+    while (--depth > 0)
+    {
+        gains[depth - 1] = -max(-gains[depth - 1], gains[depth]);
+    }
+    return gains[0];
+}
+
+auto see_ge(const BitBoard &board, const Move &move, const int threshold) -> bool
+{
+    if (move.type == movType::CASTLE_kingside || move.type == movType::CASTLE_queenside)
+    {
+        return threshold <= 0;
+    }
+    exchange_t exchange = first_exchange(board, move);
+
+    // swap is how far the side that moved last is above its target if the exchange stops here
+    int swap = exchange.gain - threshold;
+    if (swap < 0)
+    {
+        return false;
+    }
+
+    // a capture that promotes raises the capturer's balance by as much as the queen it leaves
+    // standing adds to what can be taken back, so only the early exits need the promotion gain
+    const int sq = __builtin_ctzll(exchange.to);
+    uint64_t attackers = board.attackers_to(sq, exchange.occupied) & exchange.occupied;
+    side_t side = board.whites_turn() ? side_t::white : side_t::black;
+    swap = value_of(exchange.on_square) - swap;
+    if (swap + promotion_gain(board, exchange.to, attackers, ~side) <= 0)
+    {
+        return true;
+    }
+    bool result = true;
+    for (;;)
+    {
+        side = ~side;
+        const piece_t attacker = least_valuable(board, attackers, side);
+        if (attacker == no_piece)
+        {
+            break;
+        }
+        if (kind_of(attacker) == piece_t::white_king)
+        {
+            // the king may only recapture when nothing can take it back
+            return (attackers & board[side_pcs_of(~side)]) != 0 ? result : !result;
+        }
+        result = !result;
+        swap = value_of(attacker) - swap;
+        if (swap + promotion_gain(board, exchange.to, attackers, ~side) <
+            static_cast<int>(result))
+        {
+            break;
+        }
+        attackers = remove_attacker(board, attacker, exchange.to, exchange.occupied, attackers);
+    }
+    return result;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <array>
+
+#include "bitboard.h"
+#include "move.h"
+
+// Material values used by the static exchange evaluation, indexed by piece kind pawn to king
+inline constexpr std::array<int, 6> see_piece_values = {100, 320, 330, 500, 900, 20000};
+
+// Material the side to move wins with move if both sides keep recapturing on its target square
+// with their least valuable attacker for as long as that pays off. Quiet moves score zero unless
+// the piece can be taken for free, castling always scores zero
+auto see(const BitBoard &board, const Move &move) -> int;
+
+// see(board, move) >= threshold, stopping as soon as the answer is known
+auto see_ge(const BitBoard &board, const Move &move, int threshold) -> bool;
@@ -2,21 +2,35 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <print>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include "attacks.h"
+#include "batch_gen.h"
 #include "bitboard.h"
+#include "bitscan.h"
 #include "engine.h"
+#include "eval.h"
 #include "move.h"
 #include "move_gen.h"
+#include "nnue.h"
+#include "perf_counters.h"
+#include "perft_table.h"
 #include "private.h"
+#include "see.h"
 
 using namespace std;
 
@@ -36,13 +50,74 @@ const array<pair<string, array<uint64_t, 6>>, 6> perft_tests = {
     make_pair("r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 "
               "10 ",
               array<uint64_t, 6>{46, 2079, 89890, 3894594, 164075551, 6923051137})};
+// position, move in uci notation and its static exchange evaluation
+const array<tuple<string, string, int>, 14> see_tests = {
+    make_tuple("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5", 100),
+    make_tuple("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5", -220),
+    make_tuple("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "e2e4", 0),
+    make_tuple("4k3/8/3p4/4p3/8/8/8/4QK2 w - - 0 1", "e1e5", -800),
+    make_tuple("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 100),
+    make_tuple("4k3/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7b8Q", 800),
+    make_tuple("4k3/1p6/2n5/3P4/8/8/8/4K3 w - - 0 1", "d5c6", 220),
+    make_tuple("8/8/8/8/8/4k3/R2p4/4K3 w - - 0 1", "a2d2", 100),
+    make_tuple("8/8/8/8/8/4k3/R2p4/7K w - - 0 1", "a2d2", -400),
+    make_tuple("3rk3/8/8/3p4/8/8/3R4/3RK3 w - - 0 1", "d2d5", 100),
+    make_tuple("3rk3/8/8/3p4/8/8/3R4/4K3 w - - 0 1", "d2d5", -400),
+    make_tuple("4k3/8/8/4p3/3P4/8/8/4K3 b - - 0 1", "e5d4", 100),
+    make_tuple("2R1k3/1P6/8/8/8/7q/8/4K3 b - - 0 1", "h3c8", -1200),
+    make_tuple("r1R1k3/1P6/8/8/8/7q/8/4K3 b - - 0 1", "h3c8", -300)};
+// positions searched by bench, a spread of openings, middlegames and endgames
+const array<string, 40> search_bench_fens = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+    "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+    "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+    "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+    "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+    "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1"};
+constexpr size_t perft_table_mb = 64;
 auto read_csv(const string &filename) -> vector<vector<string>>;
+auto pseudo_legal_moves(const BitBoard &board) -> vector<Move>;
+auto bench_positions() -> vector<BitBoard>;
 }  // namespace
 
 template <side_t Side>
-auto perft_search(BitBoard &board, int iter) -> uint64_t
+auto perft_search(BitBoard &board, UndoStack &undo, int iter) -> uint64_t
 {
-    if (iter == 0)
+    if (iter <= 0)
     {
         return 1;
     }
@@ -50,25 +125,315 @@ auto perft_search(BitBoard &board, int iter) -> uint64_t
 
     auto move_gen = MoveGen(board);
     move_gen.gen<Side>();
+    // the last ply only counts the legal moves, without making them
+    if (iter == 1)
+    {
+        for (const Move &move : move_gen)
+        {
+            perft += static_cast<uint64_t>(move_gen.is_legal<Side>(move));
+        }
+        return perft;
+    }
     for (const Move &move : move_gen)
     {
-        board.apply_move(move);
-        // check if move leaves white king in check
-        if (move_gen.is_king_in_check<Side>())
+        if (!move_gen.is_legal<Side>(move))
         {
-            board.apply_move(move);
             continue;
         }
-        perft += perft_search<~Side>(board, iter - 1);
-        board.apply_move(move);
+        board.make_move(move, undo);
+        perft += perft_search<~Side>(board, undo, iter - 1);
+        board.unmake_move(move, undo);
     }
     return perft;
 }
 
+auto perft_stats_t::operator+=(const perft_stats_t &other) -> perft_stats_t &
+{
+    nodes += other.nodes;
+    captures += other.captures;
+    en_passents += other.en_passents;
+    castles += other.castles;
+    promotions += other.promotions;
+    checks += other.checks;
+    checkmates += other.checkmates;
+    return *this;
+}
+
+// perft_search that makes every leaf move to sort it into the breakdown
+template <side_t Side>
+void perft_breakdown(BitBoard &board, UndoStack &undo, int iter, perft_stats_t &stats)
+{
+    if (iter <= 0)
+    {
+        stats.nodes++;
+        return;
+    }
+    auto move_gen = MoveGen(board);
+    move_gen.gen<Side>();
+    for (const Move &move : move_gen)
+    {
+        if (!move_gen.is_legal<Side>(move))
+        {
+            continue;
+        }
+        if (iter > 1)
+        {
+            board.make_move(move, undo);
+            perft_breakdown<~Side>(board, undo, iter - 1, stats);
+            board.unmake_move(move, undo);
+            continue;
+        }
+
+        const auto [from, to, captured] = move.squares(board);
+        stats.nodes++;
+        stats.captures += static_cast<uint64_t>(captured != 0);
+        stats.en_passents += static_cast<uint64_t>(captured != 0 && captured != to);
+        stats.castles += static_cast<uint64_t>(move.type == movType::CASTLE_kingside ||
+                                               move.type == movType::CASTLE_queenside);
+        stats.promotions += static_cast<uint64_t>(move.type == movType::PROMOTE ||
+                                                  move.type == movType::CAPTURE_PROMOTE);
+
+        board.make_move(move, undo);
+        auto replies = MoveGen(board);
+        if (replies.is_king_in_check<~Side>())
+        {
+            stats.checks++;
+            replies.gen<~Side>();
+            stats.checkmates += static_cast<uint64_t>(
+                none_of(replies.begin(), replies.end(),
+                        [&](const Move &reply) { return replies.is_legal<~Side>(reply); }));
+        }
+        board.unmake_move(move, undo);
+    }
+}
+
+template <side_t Side>
+auto perft_count(BitBoard &board, UndoStack &undo, int iter, bool breakdown) -> perft_stats_t
+{
+    perft_stats_t stats;
+    if (breakdown)
+    {
+        perft_breakdown<Side>(board, undo, iter, stats);
+    }
+    else
+    {
+        stats.nodes = perft_search<Side>(board, undo, iter);
+    }
+    return stats;
+}
+
+template <side_t Side>
+void perft_divide(BitBoard &board, UndoStack &undo, int depth, bool breakdown,
+                  vector<pair<string, perft_stats_t>> &results)
+{
+    auto move_gen = MoveGen(board);
+    move_gen.gen<Side>();
+    for (const Move &move : move_gen)
+    {
+        if (!move_gen.is_legal<Side>(move))
+        {
+            continue;
+        }
+        const string uci = Engine::move_to_uci(move, board);
+        board.make_move(move, undo);
+        results.emplace_back(uci, perft_count<~Side>(board, undo, depth - 1, breakdown));
+        board.unmake_move(move, undo);
+    }
+}
+
+void run_perft(BitBoard board, int depth, bool divide, bool breakdown)
+{
+    // node counts of each root move when dividing, otherwise just the total
+    vector<pair<string, perft_stats_t>> results;
+    UndoStack undo;
+    const auto start = chrono::steady_clock::now();
+    if (divide && depth > 0)
+    {
+        if (board.whites_turn())
+        {
+            perft_divide<side_t::white>(board, undo, depth, breakdown, results);
+        }
+        else
+        {
+            perft_divide<side_t::black>(board, undo, depth, breakdown, results);
+        }
+    }
+    else
+    {
+        results.emplace_back("", board.whites_turn()
+                                     ? perft_count<side_t::white>(board, undo, depth, breakdown)
+                                     : perft_count<side_t::black>(board, undo, depth, breakdown));
+    }
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    perft_stats_t total;
+    for (const auto &[uci, stats] : results)
+    {
+        if (divide)
+        {
+            print("{}: {}\n", uci, stats.nodes);
+        }
+        total += stats;
+    }
+    if (divide)
+    {
+        print("\nMoves: {}\n", results.size());
+    }
+    print("Nodes: {} | Time: {:.3f}s | {:.0f} nps\n", total.nodes, elapsed.count(),
+          static_cast<double>(total.nodes) / elapsed.count());
+    if (breakdown)
+    {
+        print("Captures: {} | E.p.: {} | Castles: {} | Promotions: {} | Checks: {} | Mates: {}\n",
+              total.captures, total.en_passents, total.castles, total.promotions, total.checks,
+              total.checkmates);
+    }
+}
+
+template <side_t Side>
+auto perft_hashed(BitBoard &board, UndoStack &undo, int iter, PerftTable &table) -> uint64_t
+{
+    // the last two plies are cheaper to count again than to look up
+    if (iter < 3)
+    {
+        return perft_search<Side>(board, undo, iter);
+    }
+    uint64_t perft = 0;
+    if (table.probe(board.hash(), iter, perft))
+    {
+        return perft;
+    }
+
+    auto move_gen = MoveGen(board);
+    move_gen.gen<Side>();
+    for (const Move &move : move_gen)
+    {
+        if (!move_gen.is_legal<Side>(move))
+        {
+            continue;
+        }
+        board.make_move(move, undo);
+        perft += perft_hashed<~Side>(board, undo, iter - 1, table);
+        board.unmake_move(move, undo);
+    }
+    table.store(board.hash(), iter, perft);
+    return perft;
+}
+
+template <side_t Side>
+auto legal_moves(const BitBoard &board) -> vector<Move>
+{
+    auto move_gen = MoveGen(board);
+    move_gen.gen<Side>();
+    vector<Move> moves;
+    copy_if(move_gen.begin(), move_gen.end(), back_inserter(moves),
+            [&](const Move &move) { return move_gen.is_legal<Side>(move); });
+    return moves;
+}
+
+// Splits the tree two plies below the root into one work item per move pair, which balances far
+// better across threads than the root moves alone
+template <side_t Side>
+auto parallel_perft(const BitBoard &root, int depth, int threads, PerftTable &table) -> uint64_t
+{
+    BitBoard board = root;
+    UndoStack undo;
+    if (depth < 3)
+    {
+        return perft_search<Side>(board, undo, depth);
+    }
+    vector<pair<Move, Move>> work;
+    for (const Move &move : legal_moves<Side>(board))
+    {
+        board.make_move(move, undo);
+        for (const Move &reply : legal_moves<~Side>(board))
+        {
+            work.emplace_back(move, reply);
+        }
+        board.unmake_move(move, undo);
+    }
+
+    atomic<size_t> next_item = 0;
+    atomic<uint64_t> perft = 0;
+    auto worker = [&]()
+    {
+        BitBoard position = root;
+        UndoStack position_undo;
+        for (size_t item = next_item++; item < work.size(); item = next_item++)
+        {
+            const auto &[move, reply] = work[item];
+            position.make_move(move, position_undo);
+            position.make_move(reply, position_undo);
+            perft += perft_hashed<Side>(position, position_undo, depth - 2, table);
+            position.unmake_move(reply, position_undo);
+            position.unmake_move(move, position_undo);
+        }
+    };
+    vector<thread> pool;
+    for (int idx = 1; idx < threads; idx++)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (thread &helper : pool)
+    {
+        helper.join();
+    }
+    return perft;
+}
+
+// Runs the whole perft suite to max_draft with 1, 2, 4 ... up to max_threads threads, each with a
+// fresh table, checking every count
+auto run_parallel_perft_test(int max_draft, int max_threads) -> bool
+{
+    bool passed = true;
+    double single_thread_nps = 0;
+    for (int threads = 1;; threads = min(threads * 2, max_threads))
+    {
+        PerftTable table(perft_table_mb);
+        uint64_t total_nodes = 0;
+        const auto start = chrono::steady_clock::now();
+        for (const auto &[fen, correct_perfts] : perft_tests)
+        {
+            const auto board = BitBoard(fen);
+            for (int draft = 1; draft <= max_draft; draft++)
+            {
+                const uint64_t perft =
+                    board.whites_turn()
+                        ? parallel_perft<side_t::white>(board, draft, threads, table)
+                        : parallel_perft<side_t::black>(board, draft, threads, table);
+                total_nodes += perft;
+                if (perft != correct_perfts.at(draft - 1))
+                {
+                    print("\tFailed, {} Draft: {} | Correct Perft: {} | This Perft: {}\n", fen,
+                          draft, correct_perfts.at(draft - 1), perft);
+                    passed = false;
+                }
+            }
+        }
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        const double nps = static_cast<double>(total_nodes) / elapsed.count();
+        if (threads == 1)
+        {
+            single_thread_nps = nps;
+        }
+        print("Threads: {} | Nodes: {} | Time: {:.3f}s | {:.0f} nps | x{:.2f}\n", threads,
+              total_nodes, elapsed.count(), nps, nps / single_thread_nps);
+        if (threads == max_threads)
+        {
+            break;
+        }
+    }
+    print("Parallel perft: {}\n", passed ? "Passed" : "Failed");
+    return passed;
+}
+
 void run_perft_test(int max_draft)
 {
     int perft_test_counter = 1;
     int tests_passed = 0;
+    uint64_t total_nodes = 0;
+    chrono::duration<double> total_time{};
+    UndoStack undo;
     for (auto [fen, correct_perfts] : perft_tests)
     {
         auto board = BitBoard(fen);
@@ -77,22 +442,27 @@ void run_perft_test(int max_draft)
         for (int idx = 0; idx < max_draft; idx++)
         {
             uint64_t perft = 0;
+            const auto start = chrono::steady_clock::now();
             if (board.whites_turn())
             {
-                perft = perft_search<side_t::white>(board, idx + 1);
+                perft = perft_search<side_t::white>(board, undo, idx + 1);
             }
             else
             {
-                perft = perft_search<side_t::black>(board, idx + 1);
+                perft = perft_search<side_t::black>(board, undo, idx + 1);
             }
+            const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            total_nodes += perft;
+            total_time += elapsed;
             if (perft == correct_perfts.at(idx))
             {
-                print("\tPassed, Draft: {}\n", idx + 1);
+                print("\tPassed, Draft: {} | {:.0f} nps\n", idx + 1,
+                      static_cast<double>(perft) / elapsed.count());
                 drafts_passed++;
             }
             else
             {
-                print("\tFailed, Draft: {} | Correct Perft: | This Perft: {}\n", idx + 1,
+                print("\tFailed, Draft: {} | Correct Perft: {} | This Perft: {}\n", idx + 1,
                       correct_perfts.at(idx), perft);
             }
         }
@@ -102,6 +472,488 @@ void run_perft_test(int max_draft)
         }
     }
     print("Pass Rate: {}/{}\n", tests_passed, perft_tests.size());
+    print("Nodes: {} | Time: {:.3f}s | {:.0f} nps\n", total_nodes, total_time.count(),
+          static_cast<double>(total_nodes) / total_time.count());
+}
+
+void run_make_unmake_bench(int reps)
+{
+    vector<pair<BitBoard, vector<Move>>> positions;
+    for (const BitBoard &board : bench_positions())
+    {
+        positions.emplace_back(board, pseudo_legal_moves(board));
+    }
+
+    uint64_t moves_per_rep = 0;
+    for (const auto &[board, moves] : positions)
+    {
+        moves_per_rep += moves.size();
+    }
+
+    auto time_scheme = [&](const string &name, auto do_and_undo)
+    {
+        uint64_t checksum = 0;
+        const auto start = chrono::steady_clock::now();
+        for (int rep = 0; rep < reps; rep++)
+        {
+            for (auto &[board, moves] : positions)
+            {
+                for (const Move &move : moves)
+                {
+                    checksum += do_and_undo(board, move);
+                }
+            }
+        }
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        const double total_moves = static_cast<double>(moves_per_rep) * reps;
+        print("{:<16} {:>8.2f} Mmoves/s ({:.3f}s, checksum {:x})\n", name,
+              total_moves / elapsed.count() / 1.0e6, elapsed.count(), checksum);
+    };
+
+    print("Make/unmake bench: {} positions, {} moves per rep, {} reps\n", positions.size(),
+          moves_per_rep, reps);
+    time_scheme("apply_move x2",
+                [](BitBoard &board, const Move &move)
+                {
+                    board.apply_move(move);
+                    const uint64_t hash = board.hash();
+                    board.apply_move(move);
+                    return hash;
+                });
+    UndoStack undo;
+    time_scheme("make/unmake",
+                [&undo](BitBoard &board, const Move &move)
+                {
+                    board.make_move(move, undo);
+                    const uint64_t hash = board.hash();
+                    board.unmake_move(move, undo);
+                    return hash;
+                });
+}
+
+auto run_slider_fill_bench(int reps) -> bool
+{
+    const vector<BitBoard> positions = bench_positions();
+
+    // the per slider lookups every whole side fill has to agree with
+    auto slider_loop = [](const BitBoard &board, const uint64_t diagonal, const uint64_t straight)
+    {
+        const uint64_t occupied = board[piece_t::all_pcs];
+        uint64_t attacks = 0;
+        for (const auto bit : BitScan(diagonal))
+        {
+            attacks |= bishop_attacks(bit, occupied);
+        }
+        for (const auto bit : BitScan(straight))
+        {
+            attacks |= rook_attacks(bit, occupied);
+        }
+        return attacks;
+    };
+    auto stored_sets = [](const BitBoard &board, const uint64_t diagonal, const uint64_t straight)
+    {
+        uint64_t attacks = 0;
+        for (const auto bit : BitScan(diagonal | straight))
+        {
+            attacks |= board.attacks_from(__builtin_ctzll(bit));
+        }
+        return attacks;
+    };
+    auto scalar_fill = [](const BitBoard &board, const uint64_t diagonal, const uint64_t straight)
+    {
+        return kogge_stone::slider_attacks_scalar(diagonal, straight, board[piece_t::all_pcs]);
+    };
+#ifdef __AVX2__
+    auto avx2_fill = [](const BitBoard &board, const uint64_t diagonal, const uint64_t straight)
+    { return kogge_stone::slider_attacks_avx2(diagonal, straight, board[piece_t::all_pcs]); };
+#endif
+
+    // calls fill once per side of every position, the sides' sliders are fixed per position
+    auto for_each_side = [&](auto fill)
+    {
+        uint64_t checksum = 0;
+        for (const BitBoard &board : positions)
+        {
+            checksum += fill(board, board[piece_t::white_bishop] | board[piece_t::white_queen],
+                             board[piece_t::white_rook] | board[piece_t::white_queen]);
+            checksum += fill(board, board[piece_t::black_bishop] | board[piece_t::black_queen],
+                             board[piece_t::black_rook] | board[piece_t::black_queen]) *
+                        3;
+        }
+        return checksum;
+    };
+
+    const uint64_t expected = for_each_side(slider_loop);
+    auto time_scheme = [&](const string &name, auto fill)
+    {
+        if (for_each_side(fill) != expected)
+        {
+            print("{:<16} FAILED, attack sets differ from the per slider lookups\n", name);
+            return false;
+        }
+        uint64_t checksum = 0;
+        const auto start = chrono::steady_clock::now();
+        for (int rep = 0; rep < reps; rep++)
+        {
+            checksum += for_each_side(fill);
+        }
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        const double total_fills = 2.0 * static_cast<double>(positions.size()) * reps;
+        print("{:<16} {:>8.2f} Mfills/s ({:.3f}s, checksum {:x})\n", name,
+              total_fills / elapsed.count() / 1.0e6, elapsed.count(), checksum);
+        return true;
+    };
+
+    print("Slider fill bench: {} positions, {} reps\n", positions.size(), reps);
+    bool passed = time_scheme("per slider", slider_loop);
+    passed &= time_scheme("stored sets", stored_sets);
+    passed &= time_scheme("kogge-stone", scalar_fill);
+#ifdef __AVX2__
+    passed &= time_scheme("kogge-stone avx2", avx2_fill);
+#endif
+    return passed;
+}
+
+auto run_batch_gen_bench(int reps) -> bool
+{
+    const vector<BitBoard> positions = bench_positions();
+    PositionBatch batch;
+    batch.reserve(positions.size());
+    for (const BitBoard &board : positions)
+    {
+        batch.push_back(board);
+    }
+    BatchResults results;
+    gen_batch(batch, results);
+
+    // the batch targets have to match the destinations of MoveGen's moves by piece kind
+    size_t failed = 0;
+    for (size_t idx = 0; idx < positions.size(); idx++)
+    {
+        const BitBoard &board = positions[idx];
+        const bool white = board.whites_turn();
+        const piece_t own_pcs = white ? piece_t::white_pcs : piece_t::black_pcs;
+        const piece_t own_king = white ? piece_t::white_king : piece_t::black_king;
+        const uint64_t occupied = board[piece_t::all_pcs] & ~board[own_king];
+        const uint64_t attacked = white ? full_side_attacks<side_t::black>(board, occupied)
+                                        : full_side_attacks<side_t::white>(board, occupied);
+
+        array<uint64_t, batch_piece_kinds> targets{};
+        for (const Move &move : pseudo_legal_moves(board))
+        {
+            if (move.type == movType::CASTLE_kingside || move.type == movType::CASTLE_queenside)
+            {
+                continue;
+            }
+            BitBoard child = board;
+            child.apply_move(move);
+            const size_t kind = static_cast<size_t>(move.pc1) % batch_piece_kinds;
+            targets[kind] |= child[own_pcs] & ~board[own_pcs];
+        }
+        targets[batch_piece_kinds - 1] &= ~attacked;
+
+        if (targets != array<uint64_t, batch_piece_kinds>{
+                           results.targets[0][idx], results.targets[1][idx],
+                           results.targets[2][idx], results.targets[3][idx],
+                           results.targets[4][idx], results.targets[5][idx]} ||
+            results.attacked[idx] != attacked ||
+            (results.in_check[idx] != 0) != ((attacked & board[own_king]) != 0))
+        {
+            failed++;
+        }
+    }
+    if (failed != 0)
+    {
+        print("Batch move gen FAILED on {} of {} positions\n", failed, positions.size());
+        return false;
+    }
+
+    uint64_t checksum = 0;
+    const auto start = chrono::steady_clock::now();
+    for (int rep = 0; rep < reps; rep++)
+    {
+        gen_batch(batch, results);
+        checksum += results.targets[0][rep % batch.size()] + results.attacked[rep % batch.size()];
+    }
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    const double total = static_cast<double>(batch.size()) * reps;
+    print("Batch move gen: {} positions, {} reps, {} lanes\n", batch.size(), reps,
+          batch_lane_count);
+    print("{:>8.2f} Mpositions/s ({:.3f}s, checksum {:x})\n", total / elapsed.count() / 1.0e6,
+          elapsed.count(), checksum);
+    return true;
+}
+
+auto run_see_test(int reps) -> bool
+{
+    bool passed = true;
+    for (const auto &[fen, uci, correct_see] : see_tests)
+    {
+        const auto board = BitBoard(fen);
+        const vector<Move> moves = pseudo_legal_moves(board);
+        const auto move = find_if(moves.begin(), moves.end(), [&](const Move &candidate)
+                                  { return Engine::move_to_uci(candidate, board) == uci; });
+        const int score = move == moves.end() ? 0 : see(board, *move);
+        if (move == moves.end() || score != correct_see || !see_ge(board, *move, correct_see) ||
+            see_ge(board, *move, correct_see + 1))
+        {
+            print("SEE failed: {} {} | Expected: {} | Got: {}\n", fen, uci, correct_see, score);
+            passed = false;
+        }
+    }
+
+    // see_ge has to agree with see on every move of the bench positions
+    vector<pair<BitBoard, vector<Move>>> positions;
+    size_t move_count = 0;
+    for (const BitBoard &board : bench_positions())
+    {
+        positions.emplace_back(board, pseudo_legal_moves(board));
+        move_count += positions.back().second.size();
+        for (const Move &move : positions.back().second)
+        {
+            const int score = see(board, move);
+            if (!see_ge(board, move, score) || see_ge(board, move, score + 1))
+            {
+                print("see_ge disagrees with see {} on {}\n", score,
+                      Engine::move_to_uci(move, board));
+                passed = false;
+            }
+        }
+    }
+    print("SEE test: {}\n", passed ? "Passed" : "Failed");
+
+    auto time_scheme = [&](const string &name, auto score_move)
+    {
+        int64_t checksum = 0;
+        const auto start = chrono::steady_clock::now();
+        for (int rep = 0; rep < reps; rep++)
+        {
+            for (const auto &[board, moves] : positions)
+            {
+                for (const Move &move : moves)
+                {
+                    checksum += score_move(board, move);
+                }
+            }
+        }
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        const double total_moves = static_cast<double>(move_count) * reps;
+        print("{:<16} {:>8.2f} Mmoves/s ({:.3f}s, checksum {})\n", name,
+              total_moves / elapsed.count() / 1.0e6, elapsed.count(), checksum);
+    };
+    print("SEE bench: {} positions, {} moves per rep, {} reps\n", positions.size(), move_count,
+          reps);
+    time_scheme("see", [](const BitBoard &board, const Move &move) { return see(board, move); });
+    time_scheme("see_ge 0", [](const BitBoard &board, const Move &move)
+                { return static_cast<int>(see_ge(board, move, 0)); });
+    return passed;
+}
+
+// nodes where the state make_move keeps up to date differed from recomputing it from scratch
+struct incremental_failures_t
+{
+    uint64_t nodes = 0;
+    uint64_t hash = 0;
+    uint64_t psqt = 0;
+    uint64_t pawn_hash = 0;
+    uint64_t material_key = 0;
+    uint64_t accumulator = 0;
+};
+
+void check_incremental(const BitBoard &board, incremental_failures_t &failures)
+{
+    const psqt_t psqt = board.compute_psqt();
+    failures.nodes++;
+    failures.hash += static_cast<uint64_t>(board.hash() != board.compute_hash());
+    failures.psqt += static_cast<uint64_t>(board.psqt().midgame != psqt.midgame ||
+                                           board.psqt().endgame != psqt.endgame);
+    failures.pawn_hash += static_cast<uint64_t>(board.pawn_hash() != board.compute_pawn_hash());
+    failures.material_key +=
+        static_cast<uint64_t>(board.material_key() != board.compute_material_key());
+    if (nnue::enabled)
+    {
+        BitBoard refreshed = board;
+        refreshed.refresh_accumulators();
+        failures.accumulator +=
+            static_cast<uint64_t>(board.accumulator().values != refreshed.accumulator().values ||
+                                  board.accumulator().buckets != refreshed.accumulator().buckets);
+    }
+}
+
+// checks every node of the perft tree, and each node again once its children are taken back
+template <side_t Side>
+void incremental_walk(BitBoard &board, UndoStack &undo, int iter, incremental_failures_t &failures)
+{
+    check_incremental(board, failures);
+    if (iter <= 0)
+    {
+        return;
+    }
+    auto move_gen = MoveGen(board);
+    move_gen.gen<Side>();
+    for (const Move &move : move_gen)
+    {
+        if (!move_gen.is_legal<Side>(move))
+        {
+            continue;
+        }
+        board.make_move(move, undo);
+        incremental_walk<~Side>(board, undo, iter - 1, failures);
+        board.unmake_move(move, undo);
+    }
+    check_incremental(board, failures);
+}
+
+auto run_incremental_test(int max_draft) -> bool
+{
+    const bool nnue_enabled = nnue::enabled;
+    bool passed = true;
+    UndoStack undo;
+    for (const bool network : {false, true})
+    {
+        nnue::enabled = network;
+        incremental_failures_t failures;
+        for (const auto &[fen, correct_perfts] : perft_tests)
+        {
+            auto board = BitBoard(fen);
+            if (board.whites_turn())
+            {
+                incremental_walk<side_t::white>(board, undo, max_draft, failures);
+            }
+            else
+            {
+                incremental_walk<side_t::black>(board, undo, max_draft, failures);
+            }
+        }
+        const uint64_t failed = failures.hash + failures.psqt + failures.pawn_hash +
+                                failures.material_key + failures.accumulator;
+        print("Incremental test, nnue {}: {} nodes | hash {} | psqt {} | pawn hash {} | "
+              "material key {} | accumulator {} | {}\n",
+              network ? "on" : "off", failures.nodes, failures.hash, failures.psqt,
+              failures.pawn_hash, failures.material_key, failures.accumulator,
+              failed == 0 ? "Passed" : "FAILED");
+        passed = passed && failed == 0;
+    }
+    nnue::enabled = nnue_enabled;
+    return passed;
+}
+
+auto run_batch_test() -> bool
+{
+    // known endings and positions with a scaler, which the batch gathers separately
+    static const vector<string> ending_fens = {
+        "8/8/8/4k3/8/8/8/3QK3 w - - 0 1",          "8/8/8/4k3/8/8/8/3NK3 w - - 0 1",
+        "8/8/8/4k3/8/8/8/3BK3 b - - 0 1",          "8/8/8/4k3/2b5/8/8/3RK3 w - - 0 1",
+        "8/8/3k4/2n5/8/8/3K4/5R2 b - - 0 1",       "8/5k2/3b2p1/1p6/1P6/2B2P2/5K2/8 w - - 0 1",
+        "8/2b2k2/5p2/1p3P2/1P6/2B5/6K1/8 b - - 0 1",
+    };
+    const bool nnue_enabled = nnue::enabled;
+    bool passed = true;
+    for (const bool network : {false, true})
+    {
+        nnue::enabled = network;
+        vector<BitBoard> boards = bench_positions();
+        for (const string &fen : ending_fens)
+        {
+            boards.emplace_back(fen);
+        }
+        eval_batch_t positions;
+        vector<int> expected;
+        for (BitBoard &board : boards)
+        {
+            board.refresh_accumulators();
+            positions.push_back(board);
+            expected.push_back(evaluate(board));
+        }
+        // the full set, leaving the known endings and scaled positions last, and lengths that
+        // end partway through a block
+        uint64_t mismatches = 0;
+        uint64_t checked = 0;
+        for (const size_t count : {size_t{1}, size_t{7}, size_t{9}, size_t{63}, size_t{65},
+                                   size_t{67}, boards.size()})
+        {
+            eval_batch_t prefix;
+            for (size_t idx = boards.size() - count; idx < boards.size(); idx++)
+            {
+                prefix.push_back(boards[idx]);
+            }
+            vector<int> evals(count, 0);
+            if (!evaluate_batch(prefix, evals))
+            {
+                mismatches++;
+                continue;
+            }
+            for (size_t idx = 0; idx < count; idx++)
+            {
+                const size_t board = boards.size() - count + idx;
+                mismatches += static_cast<uint64_t>(evals[idx] != expected[board]);
+            }
+            checked += count;
+        }
+        // too few evals for the positions has to be refused without writing any of them
+        vector<int> short_evals(positions.size() - 1, 1);
+        const bool refused = !evaluate_batch(positions, short_evals) &&
+                             ranges::all_of(short_evals, [](const int eval) { return eval == 1; });
+        const bool ok = mismatches == 0 && refused;
+        print("Batch evaluation test, nnue {}: {} evaluations | {} mismatches | short evals {} | "
+              "{}\n",
+              network ? "on" : "off", checked, mismatches, refused ? "refused" : "accepted",
+              ok ? "Passed" : "FAILED");
+        passed = passed && ok;
+    }
+    nnue::enabled = nnue_enabled;
+    return passed;
+}
+
+void run_search_bench(int depth, bool perf)
+{
+    Engine engine;
+    search_stats_t totals;
+    chrono::duration<double> total_time{};
+    // only opened when asked for, the counters are summed over the searches alone
+    unique_ptr<PerfCounters> counters = perf ? make_unique<PerfCounters>() : nullptr;
+    PerfCounters::values_t counted{};
+    for (size_t idx = 0; idx < search_bench_fens.size(); idx++)
+    {
+        engine.load(search_bench_fens.at(idx));
+        if (counters)
+        {
+            counters->start();
+        }
+        const auto start = chrono::steady_clock::now();
+        engine.run(depth);
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        if (counters)
+        {
+            const PerfCounters::values_t values = counters->stop();
+            for (size_t counter = 0; counter < values.size(); counter++)
+            {
+                counted.at(counter) += values.at(counter);
+            }
+        }
+        totals += engine.get_stats();
+        total_time += elapsed;
+        print("Position {}/{}: {} {} nodes\n", idx + 1, search_bench_fens.size(),
+              engine.get_uci(), engine.get_nodes());
+    }
+    print("\nNodes searched: {}\nTotal time (ms): {:.0f}\nNodes/second: {:.0f}\n", totals.nodes,
+          total_time.count() * 1000, static_cast<double>(totals.nodes) / total_time.count());
+    print("Pawn table hits: {:.1f}% of {} probes\n", hit_rate(totals.pawn_hits, totals.pawn_probes),
+          totals.pawn_probes);
+    print("Material table hits: {:.1f}% of {} probes\n",
+          hit_rate(totals.material_hits, totals.material_probes), totals.material_probes);
+    print("Eval cache hits: {:.1f}% of {} probes\n", hit_rate(totals.eval_hits, totals.eval_probes),
+          totals.eval_probes);
+    print("Lazy eval exits: {:.1f}% of {} evaluations\n",
+          hit_rate(totals.lazy_exits, totals.lazy_evals), totals.lazy_evals);
+    if (counters && counters->available())
+    {
+        print("{}\n", counters->summary(counted, totals.nodes, "node"));
+    }
+    if (counters && !counters->error().empty())
+    {
+        print("Hardware counters unavailable, {}\n", counters->error());
+    }
 }
 
 void test_puzzles(size_t count)
@@ -139,6 +991,38 @@ void test_puzzles(size_t count)
 
 namespace
 {
+auto pseudo_legal_moves(const BitBoard &board) -> vector<Move>
+{
+    auto move_gen = MoveGen(board);
+    if (board.whites_turn())
+    {
+        move_gen.gen<side_t::white>();
+    }
+    else
+    {
+        move_gen.gen<side_t::black>();
+    }
+    return {move_gen.begin(), move_gen.end()};
+}
+
+// every perft test position and all of its children
+auto bench_positions() -> vector<BitBoard>
+{
+    vector<BitBoard> positions;
+    for (const auto &[fen, correct_perfts] : perft_tests)
+    {
+        const auto root = BitBoard(fen);
+        for (const Move &move : pseudo_legal_moves(root))
+        {
+            BitBoard child = root;
+            child.apply_move(move);
+            positions.push_back(child);
+        }
+        positions.push_back(root);
+    }
+    return positions;
+}
+
 auto read_csv(const string &filename) -> vector<vector<string>>
 {
     vector<vector<string>> result;
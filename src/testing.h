@@ -2,7 +2,40 @@
 
 #include "bitboard.h"
 
+// leaf counts of a perft, the breakdown is only filled in when asked for
+struct perft_stats_t
+{
+    uint64_t nodes = 0;
+    uint64_t captures = 0;
+    uint64_t en_passents = 0;
+    uint64_t castles = 0;
+    uint64_t promotions = 0;
+    uint64_t checks = 0;
+    uint64_t checkmates = 0;
+
+    auto operator+=(const perft_stats_t &other) -> perft_stats_t &;
+};
+
+// depth searched by bench when none is given
+inline constexpr int default_search_bench_depth = 5;
+
+void run_perft(BitBoard board, int depth, bool divide, bool breakdown);
 void run_perft_test(int max_draft);
+auto run_parallel_perft_test(int max_draft, int max_threads) -> bool;
+void run_make_unmake_bench(int reps);
+auto run_slider_fill_bench(int reps) -> bool;
+auto run_batch_gen_bench(int reps) -> bool;
+auto run_see_test(int reps) -> bool;
+// walks the perft test positions to max_draft comparing everything make_move updates in place
+// with recomputing it, once with the network enabled so its accumulators are checked too
+auto run_incremental_test(int max_draft) -> bool;
+// compares evaluate_batch with evaluate over the bench positions and some known and scaled
+// endings, at batch lengths that end partway through a block, with the network off and on
+auto run_batch_test() -> bool;
+// searches every bench position to depth and reports the total nodes, which only change when the
+// search does, along with the time taken and nodes per second. perf adds the hardware counters
+// per node where the system lets us read them
+void run_search_bench(int depth, bool perf = false);
 template <side_t side>
-auto perft_search(BitBoard &board, int iter) -> uint64_t;
+auto perft_search(BitBoard &board, UndoStack &undo, int iter) -> uint64_t;
 void test_puzzles(size_t count);
@@ -0,0 +1,165 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+struct event_t
+{
+    array<char, trace::max_name_length + 1> name;
+    int64_t time_ns;
+    int64_t value;
+    trace::phase_t phase;
+};
+
+struct thread_buffer_t
+{
+    array<event_t, trace::buffer_events> events;
+    // events ever written, the ring holds the last buffer_events of them
+    atomic<size_t> count = 0;
+    atomic_bool in_use = true;
+    int tid = 0;
+};
+
+const auto epoch = chrono::steady_clock::now();
+
+// every buffer ever handed out, the lock is only taken when a thread records its first event and
+// when dumping
+mutex registry_mutex;
+vector<unique_ptr<thread_buffer_t>> registry;
+
+// reuses the buffer of a thread that has finished, so the engine's short lived search threads
+// share one timeline row instead of each getting their own
+auto acquire_buffer() -> thread_buffer_t *
+{
+    const lock_guard lock(registry_mutex);
+    for (const auto &buffer : registry)
+    {
+        if (!buffer->in_use)
+        {
+            buffer->in_use = true;
+            return buffer.get();
+        }
+    }
+    registry.push_back(make_unique<thread_buffer_t>());
+    registry.back()->tid = static_cast<int>(registry.size());
+    return registry.back().get();
+}
+
+// hands the buffer back when its thread ends
+struct buffer_handle_t
+{
+    thread_buffer_t *buffer = acquire_buffer();
+
+    buffer_handle_t() = default;
+    ~buffer_handle_t() { buffer->in_use = false; }
+    buffer_handle_t(const buffer_handle_t &) = delete;
+    auto operator=(const buffer_handle_t &) -> buffer_handle_t & = delete;
+    buffer_handle_t(buffer_handle_t &&) = delete;
+    auto operator=(buffer_handle_t &&) -> buffer_handle_t & = delete;
+};
+
+auto local_buffer() -> thread_buffer_t &
+{
+    thread_local buffer_handle_t handle;
+    return *handle.buffer;
+}
+
+// names come from commands typed in, so quotes and control characters are escaped or dropped
+auto json_escape(const string_view text) -> string
+{
+    string out;
+    for (const char chr : text)
+    {
+        if (chr == '"' || chr == '\\')
+        {
+            out += '\\';
+            out += chr;
+        }
+        else if (static_cast<unsigned char>(chr) >= ' ')
+        {
+            out += chr;
+        }
+    }
+    return out;
+}
+}  // namespace
+
+void trace::record(const string_view name, const phase_t phase, const int64_t value)
+{
+    thread_buffer_t &buffer = local_buffer();
+    const size_t count = buffer.count.load(memory_order_relaxed);
+    event_t &event = buffer.events[count % buffer_events];
+    const size_t length = min(name.size(), max_name_length);
+    copy_n(name.begin(), length, event.name.begin());
+    event.name[length] = '\0';
+    event.time_ns =
+        chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+    event.value = value;
+    event.phase = phase;
+    buffer.count.store(count + 1, memory_order_release);
+}
+
+auto trace::dump(const string &filename) -> bool
+{
+    if constexpr (!enabled)
+    {
+        return false;
+    }
+    ofstream file(filename);
+    if (!file)
+    {
+        return false;
+    }
+    file << "{\"traceEvents\": [\n";
+    bool first = true;
+    const lock_guard lock(registry_mutex);
+    for (const auto &buffer : registry)
+    {
+        const size_t count = buffer->count.load(memory_order_acquire);
+        for (size_t idx = count - min(count, buffer_events); idx < count; idx++)
+        {
+            const event_t &event = buffer->events[idx % buffer_events];
+            file << (first ? "" : ",\n")
+                 << format("{{\"name\": \"{}\", \"ph\": \"{}\", \"ts\": {:.3f}, \"pid\": 1, "
+                           "\"tid\": {}",
+                           json_escape(event.name.data()), static_cast<char>(event.phase),
+                           static_cast<double>(event.time_ns) / 1000.0, buffer->tid);
+            if (event.phase == phase_t::instant)
+            {
+                file << ", \"s\": \"t\"";
+            }
+            if (event.value >= 0)
+            {
+                file << format(", \"args\": {{\"value\": {}}}", event.value);
+            }
+            file << "}";
+            first = false;
+        }
+    }
+    file << "\n], \"displayTimeUnit\": \"ms\"}\n";
+    return static_cast<bool>(file);
+}
+
+void trace::clear()
+{
+    const lock_guard lock(registry_mutex);
+    for (const auto &buffer : registry)
+    {
+        buffer->count = 0;
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Timeline of what each thread was doing, written out in the Chrome Trace Event format so it can
+// be loaded into chrome://tracing or Perfetto. Recording is compiled in with ELWELLBOT_TRACE,
+// otherwise every call below is empty. Each thread writes to its own ring buffer so recording
+// never takes a lock, once a buffer is full its oldest events are overwritten
+namespace trace
+{
+#ifdef ELWELLBOT_TRACE
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+enum class phase_t : char
+{
+    begin = 'B',
+    end = 'E',
+    instant = 'i'
+};
+
+// events per thread kept before the oldest are overwritten
+inline constexpr size_t buffer_events = 1 << 14;
+// longer names are cut short
+inline constexpr size_t max_name_length = 31;
+
+// value is shown as the event's argument unless it is negative
+void record(std::string_view name, phase_t phase, int64_t value);
+
+inline void begin(std::string_view name, int64_t value = -1)
+{
+    if constexpr (enabled)
+    {
+        record(name, phase_t::begin, value);
+    }
+}
+
+inline void end(std::string_view name, int64_t value = -1)
+{
+    if constexpr (enabled)
+    {
+        record(name, phase_t::end, value);
+    }
+}
+
+inline void instant(std::string_view name, int64_t value = -1)
+{
+    if constexpr (enabled)
+    {
+        record(name, phase_t::instant, value);
+    }
+}
+
+// Writes every thread's events to filename, only call it while no other thread is recording
+auto dump(const std::string &filename) -> bool;
+void clear();
+}  // namespace trace
@@ -0,0 +1,683 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <print>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "bitboard.h"
+#include "mapped_file.h"
+#include "nnue.h"
+#include "training_data.h"
+
+using namespace std;
+
+// ElwellTrain convert [positions.txt] [positions.bin]
+// ElwellTrain train [positions.bin] [network.nnue] [--threads n] [--epochs n] [--batch n]
+//     [--lr rate] [--lambda weight] [--seed n]
+// ElwellTrain scaling [positions.bin] [--threads max] [--epochs n] [--batch n]
+//
+// Trains networks for nnue.h on the CPU. convert packs "fen;score;result" lines into the 32 byte
+// records of training_data.h, which train then maps and reads by index. The float network mirrors
+// the quantised one, with activations clipped to [0, 1] where the engine clips to
+// [0, activation_max], and its output is the side to move's evaluation over eval_scale. Each
+// minibatch is split across the threads, which run the forward and backward passes on their share
+// into their own gradients, then each thread sums and applies Adam to its own slice of the
+// weights. Every validation_stride'th position is held out to check against over-fitting, and the
+// exported network is loaded back through nnue::load and compared with the float network on them.
+// scaling trains from the same start with each power of two threads and reports samples/s, up to
+// the hardware's thread count unless --threads says otherwise
+
+namespace
+{
+// the float network's output times this is centipawns, and its sigmoid the expected score
+constexpr float eval_scale = 400;
+// the exported output layer's sum divided by this is centipawns
+constexpr int output_divisor = 16;
+// what a float weight or bias of 1 becomes in each quantised layer
+constexpr float ft_scale = nnue::activation_max;
+constexpr float l1_scale = 1 << nnue::l1_shift;
+constexpr float output_scale =
+    eval_scale * static_cast<float>(output_divisor) / nnue::activation_max;
+constexpr size_t validation_stride = 20;
+
+// every weight and bias in one vector, laid out in the order of the network file
+constexpr size_t ft_weights_at = 0;
+constexpr size_t ft_biases_at = ft_weights_at + (nnue::features * nnue::hidden);
+constexpr size_t l1_weights_at = ft_biases_at + nnue::hidden;
+constexpr size_t l1_biases_at = l1_weights_at + (nnue::l1_size * 2 * nnue::hidden);
+constexpr size_t output_weights_at = l1_biases_at + nnue::l1_size;
+constexpr size_t output_bias_at = output_weights_at + nnue::l1_size;
+constexpr size_t parameter_count = output_bias_at + 1;
+
+constexpr float adam_beta1 = 0.9F;
+constexpr float adam_beta2 = 0.999F;
+constexpr float adam_epsilon = 1e-8F;
+
+struct options_t
+{
+    int threads = max(static_cast<int>(thread::hardware_concurrency()), 1);
+    int epochs = 20;
+    size_t batch = 4096;
+    float learning_rate = 1e-3F;
+    // the weight of the score against the game result in the target
+    float lambda = 0.75F;
+    uint32_t seed = 1;
+};
+
+// dst += scale * src, count a multiple of 8
+void axpy(float *dst, const float *src, const float scale, const size_t count)
+{
+#ifdef __AVX2__
+    const __m256 factor = _mm256_set1_ps(scale);
+    for (size_t idx = 0; idx < count; idx += 8)
+    {
+        const __m256 scaled = _mm256_mul_ps(factor, _mm256_loadu_ps(src + idx));
+        _mm256_storeu_ps(dst + idx, _mm256_add_ps(_mm256_loadu_ps(dst + idx), scaled));
+    }
+#else
+    for (size_t idx = 0; idx < count; idx++)
+    {
+        dst[idx] += scale * src[idx];
+    }
+#endif
+}
+
+// count a multiple of 8
+auto dot(const float *lhs, const float *rhs, const size_t count) -> float
+{
+#ifdef __AVX2__
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t idx = 0; idx < count; idx += 8)
+    {
+        sum = _mm256_add_ps(sum,
+                            _mm256_mul_ps(_mm256_loadu_ps(lhs + idx), _mm256_loadu_ps(rhs + idx)));
+    }
+    const __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    const __m128 quarter = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    return _mm_cvtss_f32(_mm_add_ss(quarter, _mm_shuffle_ps(quarter, quarter, 0b01)));
+#else
+    float sum = 0;
+    for (size_t idx = 0; idx < count; idx++)
+    {
+        sum += lhs[idx] * rhs[idx];
+    }
+    return sum;
+#endif
+}
+
+auto sigmoid(const float value) -> float { return 1 / (1 + exp(-value)); }
+
+// one position's features and activations, kept from the forward pass for the backward pass.
+// Index 0 is the side to move's perspective and 1 the other side's, as in nnue::evaluate
+struct sample_t
+{
+    array<array<size_t, 32>, 2> features;
+    size_t feature_count;
+    array<array<float, nnue::hidden>, 2> accumulators;
+    array<float, 2 * nnue::hidden> inputs;
+    array<float, nnue::l1_size> hidden_sums;
+    array<float, nnue::l1_size> hidden_outputs;
+    float output;
+    float target;
+};
+
+// the sample's features and its target, the blend of the expected score from the search score
+// and the game result that lambda gives
+void set_features(const packed_position_t &position, const float lambda, sample_t &sample)
+{
+    array<piece_t, 32> pieces{};
+    array<int, 32> squares{};
+    array<int, 2> kings{};
+    size_t count = 0;
+    for_each_piece(position,
+                   [&](const piece_t piece, const int sq)
+                   {
+                       if (piece == piece_t::white_king || piece == piece_t::black_king)
+                       {
+                           kings.at(piece == piece_t::white_king ? 0 : 1) = sq;
+                       }
+                       pieces.at(count) = piece;
+                       squares.at(count) = sq;
+                       count++;
+                   });
+    const size_t us = position.white_to_move != 0 ? 0 : 1;
+    for (size_t side = 0; side < 2; side++)
+    {
+        const size_t perspective = side == 0 ? us : us ^ 1;
+        const uint8_t bucket = nnue::king_bucket(perspective, kings.at(perspective));
+        for (size_t idx = 0; idx < count; idx++)
+        {
+            sample.features.at(side).at(idx) = nnue::feature(
+                perspective, static_cast<size_t>(pieces.at(idx)), squares.at(idx), bucket);
+        }
+    }
+    sample.feature_count = count;
+
+    const float score = position.white_to_move != 0 ? position.score : -position.score;
+    const float result = position.white_to_move != 0 ? position.result / 2.0F
+                                                     : 1 - (position.result / 2.0F);
+    sample.target = (lambda * sigmoid(score / eval_scale)) + ((1 - lambda) * result);
+}
+
+// the float network's output for the sample, whose activations are kept for backward
+auto forward(const vector<float> &params, sample_t &sample) -> float
+{
+    for (size_t side = 0; side < 2; side++)
+    {
+        auto &accumulator = sample.accumulators.at(side);
+        copy_n(params.data() + ft_biases_at, nnue::hidden, accumulator.data());
+        for (size_t idx = 0; idx < sample.feature_count; idx++)
+        {
+            axpy(accumulator.data(),
+                 params.data() + ft_weights_at + (sample.features.at(side).at(idx) * nnue::hidden),
+                 1, nnue::hidden);
+        }
+        for (size_t idx = 0; idx < nnue::hidden; idx++)
+        {
+            sample.inputs.at((side * nnue::hidden) + idx) = clamp(accumulator.at(idx), 0.0F, 1.0F);
+        }
+    }
+    sample.output = params[output_bias_at];
+    for (size_t unit = 0; unit < nnue::l1_size; unit++)
+    {
+        sample.hidden_sums.at(unit) =
+            params[l1_biases_at + unit] +
+            dot(sample.inputs.data(), params.data() + l1_weights_at + (unit * 2 * nnue::hidden),
+                2 * nnue::hidden);
+        sample.hidden_outputs.at(unit) = clamp(sample.hidden_sums.at(unit), 0.0F, 1.0F);
+        sample.output += sample.hidden_outputs.at(unit) * params[output_weights_at + unit];
+    }
+    return sample.output;
+}
+
+// adds the gradient of the loss, whose derivative by the output is d_output, to grads
+void backward(const vector<float> &params, const sample_t &sample, const float d_output,
+              vector<float> &grads)
+{
+    grads[output_bias_at] += d_output;
+    array<float, 2 * nnue::hidden> d_inputs{};
+    for (size_t unit = 0; unit < nnue::l1_size; unit++)
+    {
+        grads[output_weights_at + unit] += d_output * sample.hidden_outputs.at(unit);
+        const float sum = sample.hidden_sums.at(unit);
+        if (sum <= 0 || sum >= 1)
+        {
+            continue;
+        }
+        const float d_sum = d_output * params[output_weights_at + unit];
+        grads[l1_biases_at + unit] += d_sum;
+        axpy(grads.data() + l1_weights_at + (unit * 2 * nnue::hidden), sample.inputs.data(), d_sum,
+             2 * nnue::hidden);
+        axpy(d_inputs.data(), params.data() + l1_weights_at + (unit * 2 * nnue::hidden), d_sum,
+             2 * nnue::hidden);
+    }
+    for (size_t side = 0; side < 2; side++)
+    {
+        float *d_accumulator = d_inputs.data() + (side * nnue::hidden);
+        for (size_t idx = 0; idx < nnue::hidden; idx++)
+        {
+            const float value = sample.accumulators.at(side).at(idx);
+            d_accumulator[idx] = value <= 0 || value >= 1 ? 0 : d_accumulator[idx];
+        }
+        axpy(grads.data() + ft_biases_at, d_accumulator, 1, nnue::hidden);
+        for (size_t idx = 0; idx < sample.feature_count; idx++)
+        {
+            axpy(grads.data() + ft_weights_at + (sample.features.at(side).at(idx) * nnue::hidden),
+                 d_accumulator, 1, nnue::hidden);
+        }
+    }
+}
+
+// runs work(thread) on each of threads threads and waits for them all
+void parallel(const int threads, const function<void(int)> &work)
+{
+    vector<thread> pool;
+    for (int thread_idx = 1; thread_idx < threads; thread_idx++)
+    {
+        pool.emplace_back(work, thread_idx);
+    }
+    work(0);
+    for (thread &worker : pool)
+    {
+        worker.join();
+    }
+}
+
+// the part of count that thread_idx of threads handles
+auto share(const size_t count, const int threads, const int thread_idx) -> pair<size_t, size_t>
+{
+    const auto parts = static_cast<size_t>(threads);
+    const auto part = static_cast<size_t>(thread_idx);
+    return {count * part / parts, count * (part + 1) / parts};
+}
+
+class Trainer
+{
+   private:
+    options_t m_options;
+    span<const packed_position_t> m_positions;
+    vector<size_t> m_training;
+    vector<size_t> m_validation;
+    vector<float> m_params;
+    vector<float> m_moments;
+    vector<float> m_velocities;
+    vector<vector<float>> m_grads;
+    int m_step = 0;
+    mt19937 m_rng;
+
+    // the squared error summed over the positions in order, adding its gradient to grads if it
+    // isn't null
+    auto run_positions(span<const size_t> order, vector<float> *grads) const -> double
+    {
+        double loss = 0;
+        sample_t sample{};
+        for (const size_t idx : order)
+        {
+            set_features(m_positions[idx], m_options.lambda, sample);
+            const float predicted = sigmoid(forward(m_params, sample));
+            const float error = predicted - sample.target;
+            loss += error * error;
+            if (grads != nullptr)
+            {
+                backward(m_params, sample, 2 * error * predicted * (1 - predicted), *grads);
+            }
+        }
+        return loss;
+    }
+
+    // sums the threads' gradients over [begin, end) of the weights and takes an Adam step there,
+    // keeping each weight inside what its quantised layer can hold
+    void apply_gradients(const size_t begin, const size_t end, const size_t batch)
+    {
+        const float correction1 = 1 - pow(adam_beta1, static_cast<float>(m_step));
+        const float correction2 = 1 - pow(adam_beta2, static_cast<float>(m_step));
+        const float rate = m_options.learning_rate * sqrt(correction2) / correction1;
+        for (size_t idx = begin; idx < end; idx++)
+        {
+            float grad = 0;
+            for (const vector<float> &grads : m_grads)
+            {
+                grad += grads[idx];
+            }
+            grad /= static_cast<float>(batch);
+            m_moments[idx] = (adam_beta1 * m_moments[idx]) + ((1 - adam_beta1) * grad);
+            m_velocities[idx] = (adam_beta2 * m_velocities[idx]) + ((1 - adam_beta2) * grad * grad);
+            m_params[idx] -= rate * m_moments[idx] / (sqrt(m_velocities[idx]) + adam_epsilon);
+
+            float limit = numeric_limits<float>::max();
+            if (idx < l1_weights_at)
+            {
+                limit = numeric_limits<int16_t>::max() / ft_scale;
+            }
+            else if (idx < l1_biases_at)
+            {
+                limit = numeric_limits<int8_t>::max() / l1_scale;
+            }
+            else if (idx >= output_weights_at && idx < output_bias_at)
+            {
+                limit = numeric_limits<int8_t>::max() / output_scale;
+            }
+            m_params[idx] = clamp(m_params[idx], -limit, limit);
+        }
+    }
+
+    // returns the batch's summed loss from before the step
+    auto train_batch(span<const size_t> order) -> double
+    {
+        m_step++;
+        const int threads = m_options.threads;
+        vector<double> losses(static_cast<size_t>(threads), 0.0);
+        parallel(threads,
+                 [&](const int thread_idx)
+                 {
+                     vector<float> &grads = m_grads.at(static_cast<size_t>(thread_idx));
+                     ranges::fill(grads, 0.0F);
+                     const auto [begin, end] = share(order.size(), threads, thread_idx);
+                     losses.at(static_cast<size_t>(thread_idx)) =
+                         run_positions(order.subspan(begin, end - begin), &grads);
+                 });
+        parallel(threads,
+                 [&](const int thread_idx)
+                 {
+                     const auto [begin, end] = share(parameter_count, threads, thread_idx);
+                     apply_gradients(begin, end, order.size());
+                 });
+        return accumulate(losses.begin(), losses.end(), 0.0);
+    }
+
+   public:
+    Trainer(const options_t &options, span<const packed_position_t> positions)
+        : m_options(options),
+          m_positions(positions),
+          m_params(parameter_count, 0.0F),
+          m_moments(parameter_count, 0.0F),
+          m_velocities(parameter_count, 0.0F),
+          m_grads(static_cast<size_t>(options.threads), vector<float>(parameter_count, 0.0F)),
+          m_rng(options.seed)
+    {
+        for (size_t idx = 0; idx < positions.size(); idx++)
+        {
+            (idx % validation_stride == 0 ? m_validation : m_training).push_back(idx);
+        }
+        normal_distribution<float> ft_init(0, 0.05F);
+        normal_distribution<float> l1_init(0, sqrt(2.0F / (2 * nnue::hidden)));
+        normal_distribution<float> output_init(0, 0.1F);
+        for (size_t idx = ft_weights_at; idx < ft_biases_at; idx++)
+        {
+            m_params[idx] = ft_init(m_rng);
+        }
+        for (size_t idx = l1_weights_at; idx < l1_biases_at; idx++)
+        {
+            m_params[idx] = l1_init(m_rng);
+        }
+        for (size_t idx = output_weights_at; idx < output_bias_at; idx++)
+        {
+            m_params[idx] = output_init(m_rng);
+        }
+    }
+
+    [[nodiscard]] auto training_size() const -> size_t { return m_training.size(); }
+    [[nodiscard]] auto validation() const -> span<const size_t> { return m_validation; }
+
+    // one shuffled pass over the training positions, returning their mean loss as each batch
+    // found it
+    auto train_epoch() -> double
+    {
+        ranges::shuffle(m_training, m_rng);
+        double loss = 0;
+        for (size_t begin = 0; begin < m_training.size(); begin += m_options.batch)
+        {
+            const size_t end = min(begin + m_options.batch, m_training.size());
+            loss += train_batch(span<const size_t>(m_training).subspan(begin, end - begin));
+        }
+        return loss / static_cast<double>(max<size_t>(m_training.size(), 1));
+    }
+
+    auto mean_loss(span<const size_t> order) const -> double
+    {
+        vector<double> losses(static_cast<size_t>(m_options.threads), 0.0);
+        parallel(m_options.threads,
+                 [&](const int thread_idx)
+                 {
+                     const auto [begin, end] = share(order.size(), m_options.threads, thread_idx);
+                     losses.at(static_cast<size_t>(thread_idx)) =
+                         run_positions(order.subspan(begin, end - begin), nullptr);
+                 });
+        return order.empty() ? 0 : accumulate(losses.begin(), losses.end(), 0.0) /
+                                       static_cast<double>(order.size());
+    }
+
+    // the float network's evaluation from white's side in centipawns
+    [[nodiscard]] auto evaluate(const packed_position_t &position) const -> float
+    {
+        sample_t sample{};
+        set_features(position, m_options.lambda, sample);
+        const float eval = forward(m_params, sample) * eval_scale;
+        return position.white_to_move != 0 ? eval : -eval;
+    }
+
+    auto export_network(const string &filename) const -> bool;
+};
+
+template <typename T>
+auto quantise(const float value, const float scale) -> T
+{
+    const auto scaled = static_cast<int64_t>(lround(value * scale));
+    return static_cast<T>(
+        clamp<int64_t>(scaled, numeric_limits<T>::min(), numeric_limits<T>::max()));
+}
+
+template <typename T>
+void write_layer(ofstream &file, span<const float> values, const float scale)
+{
+    vector<T> quantised(values.size());
+    ranges::transform(values, quantised.begin(),
+                      [scale](const float value) { return quantise<T>(value, scale); });
+    file.write(reinterpret_cast<const char *>(quantised.data()),  // NOLINT
+               static_cast<streamsize>(quantised.size() * sizeof(T)));
+}
+
+auto Trainer::export_network(const string &filename) const -> bool
+{
+    const nnue::network_header_t header{.magic = nnue::network_magic,
+                                        .king_buckets = nnue::king_buckets,
+                                        .features = nnue::features,
+                                        .hidden = nnue::hidden,
+                                        .l1_size = nnue::l1_size,
+                                        .output_divisor = output_divisor,
+                                        .reserved = 0};
+    const span<const float> params(m_params);
+    ofstream file(filename, ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));  // NOLINT
+    write_layer<int16_t>(file, params.subspan(ft_biases_at, nnue::hidden), ft_scale);
+    write_layer<int16_t>(file, params.subspan(ft_weights_at, ft_biases_at - ft_weights_at),
+                         ft_scale);
+    write_layer<int32_t>(file, params.subspan(l1_biases_at, nnue::l1_size), ft_scale * l1_scale);
+    write_layer<int8_t>(file, params.subspan(l1_weights_at, l1_biases_at - l1_weights_at),
+                        l1_scale);
+    write_layer<int32_t>(file, params.subspan(output_bias_at, 1), ft_scale * output_scale);
+    write_layer<int8_t>(file, params.subspan(output_weights_at, nnue::l1_size), output_scale);
+    return file.good();
+}
+
+auto parse_options(span<const string_view> args, options_t &options) -> bool
+{
+    for (size_t idx = 0; idx + 1 < args.size(); idx += 2)
+    {
+        const string value(args[idx + 1]);
+        if (args[idx] == "--threads")
+        {
+            options.threads = max(stoi(value), 1);
+        }
+        else if (args[idx] == "--epochs")
+        {
+            options.epochs = max(stoi(value), 1);
+        }
+        else if (args[idx] == "--batch")
+        {
+            options.batch = static_cast<size_t>(max(stoi(value), 1));
+        }
+        else if (args[idx] == "--lr")
+        {
+            options.learning_rate = stof(value);
+        }
+        else if (args[idx] == "--lambda")
+        {
+            options.lambda = clamp(stof(value), 0.0F, 1.0F);
+        }
+        else if (args[idx] == "--seed")
+        {
+            options.seed = static_cast<uint32_t>(stoul(value));
+        }
+        else
+        {
+            println(stderr, "Unknown option: {}", args[idx]);
+            return false;
+        }
+    }
+    return args.size() % 2 == 0;
+}
+
+auto positions_of(const MappedFile &file) -> span<const packed_position_t>
+{
+    const span<const std::byte> bytes = file.bytes();
+    if (bytes.empty() || bytes.size() % sizeof(packed_position_t) != 0)
+    {
+        return {};
+    }
+    return {reinterpret_cast<const packed_position_t *>(bytes.data()),  // NOLINT
+            bytes.size() / sizeof(packed_position_t)};
+}
+
+auto convert(const string &input, const string &output) -> int
+{
+    ifstream in(input);
+    ofstream out(output, ios::binary);
+    if (!in || !out)
+    {
+        println(stderr, "Failed to open {} or {}", input, output);
+        return 1;
+    }
+    size_t written = 0;
+    size_t skipped = 0;
+    string line;
+    while (getline(in, line))
+    {
+        if (line.empty() || line.front() == '#')
+        {
+            continue;
+        }
+        const optional<packed_position_t> position = parse_training_line(line);
+        if (!position)
+        {
+            skipped++;
+            continue;
+        }
+        out.write(reinterpret_cast<const char *>(&*position), sizeof(*position));  // NOLINT
+        written++;
+    }
+    println("Wrote {} positions to {}, skipped {} unreadable lines", written, output, skipped);
+    return 0;
+}
+
+// how far the exported network, run by the engine, is from the float network
+void compare_export(const Trainer &trainer, span<const packed_position_t> positions)
+{
+    double total = 0;
+    double worst = 0;
+    for (const size_t idx : trainer.validation())
+    {
+        BitBoard board(unpack_fen(positions[idx]));
+        board.refresh_accumulators();
+        const double error = abs(nnue::evaluate(board) - trainer.evaluate(positions[idx]));
+        total += error;
+        worst = max(worst, error);
+    }
+    const auto count = static_cast<double>(max<size_t>(trainer.validation().size(), 1));
+    println("Quantised against float evaluation: mean error {:.1f}cp, max {:.1f}cp", total / count,
+            worst);
+}
+
+auto train(const string &input, const string &output, const options_t &options) -> int
+{
+    const MappedFile file(input);
+    const span<const packed_position_t> positions = positions_of(file);
+    if (positions.empty())
+    {
+        println(stderr, "No training positions in {}", input);
+        return 1;
+    }
+    Trainer trainer(options, positions);
+    println("{} training and {} validation positions, {} threads, batch {}",
+            trainer.training_size(), trainer.validation().size(), options.threads, options.batch);
+    for (int epoch = 1; epoch <= options.epochs; epoch++)
+    {
+        const auto start = chrono::steady_clock::now();
+        const double loss = trainer.train_epoch();
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        println("epoch {:>3}  train loss {:.6f}  validation loss {:.6f}  {:.0f} samples/s", epoch,
+                loss, trainer.mean_loss(trainer.validation()),
+                static_cast<double>(trainer.training_size()) / elapsed.count());
+    }
+    if (!trainer.export_network(output))
+    {
+        println(stderr, "Failed to write {}", output);
+        return 1;
+    }
+    if (!nnue::load(output))
+    {
+        println(stderr, "The engine can't read the network written to {}", output);
+        return 1;
+    }
+    println("Wrote {}", output);
+    compare_export(trainer, positions);
+    return 0;
+}
+
+// trains from the same start on 1, 2, 4 ... threads up to options.threads
+auto scaling(const string &input, options_t options) -> int
+{
+    const MappedFile file(input);
+    const span<const packed_position_t> positions = positions_of(file);
+    if (positions.empty())
+    {
+        println(stderr, "No training positions in {}", input);
+        return 1;
+    }
+    const int max_threads = options.threads;
+    double single = 0;
+    println("{:>8} {:>14} {:>10}", "threads", "samples/s", "speedup");
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        options.threads = threads;
+        Trainer trainer(options, positions);
+        const auto start = chrono::steady_clock::now();
+        for (int epoch = 0; epoch < options.epochs; epoch++)
+        {
+            trainer.train_epoch();
+        }
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        const double rate =
+            static_cast<double>(trainer.training_size() * static_cast<size_t>(options.epochs)) /
+            elapsed.count();
+        single = threads == 1 ? rate : single;
+        println("{:>8} {:>14.0f} {:>10.2f}", threads, rate, rate / single);
+    }
+    return 0;
+}
+}  // namespace
+
+auto main(int argc, char *argv[]) -> int
+{
+    const vector<string_view> args(argv + 1, argv + argc);
+    const size_t positional = args.empty() ? 0 : (args.front() == "scaling" ? 2 : 3);
+    options_t options;
+    if (args.size() < positional || positional == 0)
+    {
+        println(stderr, "Usage: ElwellTrain convert|train|scaling, see src/train_main.cpp");
+        return 1;
+    }
+    try
+    {
+        if (!parse_options(span(args).subspan(positional), options))
+        {
+            return 1;
+        }
+    }
+    catch (exception &e)
+    {
+        println(stderr, "Failed to read options: {}", e.what());
+        return 1;
+    }
+    if (args[0] == "convert")
+    {
+        return convert(string(args[1]), string(args[2]));
+    }
+    if (args[0] == "train")
+    {
+        return train(string(args[1]), string(args[2]), options);
+    }
+    if (args[0] == "scaling")
+    {
+        return scaling(string(args[1]), options);
+    }
+    println(stderr, "Unknown command: {}", args[0]);
+    return 1;
+}
@@ -0,0 +1,108 @@
+#include "training_data.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <string>
+
+#include "bitboard.h"
+
+using namespace std;
+
+namespace
+{
+constexpr array<char, 12> piece_chars = {'P', 'N', 'B', 'R', 'Q', 'K',
+                                         'p', 'n', 'b', 'r', 'q', 'k'};
+}  // namespace
+
+auto pack_position(const BitBoard &board, const int score, const uint8_t result)
+    -> packed_position_t
+{
+    packed_position_t position{.occupied = board[piece_t::all_pcs],
+                               .pieces = {},
+                               .score = static_cast<int16_t>(score),
+                               .result = result,
+                               .white_to_move = static_cast<uint8_t>(board.whites_turn()),
+                               .reserved = 0};
+    uint64_t occupied = position.occupied;
+    for (size_t idx = 0; occupied != 0; idx++, occupied &= occupied - 1)
+    {
+        const auto piece = static_cast<uint8_t>(board.piece_on(__builtin_ctzll(occupied)));
+        position.pieces.at(idx / 2) |= idx % 2 == 0 ? piece : static_cast<uint8_t>(piece << 4);
+    }
+    return position;
+}
+
+auto parse_training_line(const string &line) -> optional<packed_position_t>
+{
+    const size_t score_start = line.find(';');
+    const size_t result_start = line.find(';', score_start + 1);
+    if (score_start == string::npos || result_start == string::npos)
+    {
+        return nullopt;
+    }
+    int score = 0;
+    double result = 0;
+    try
+    {
+        score = stoi(line.substr(score_start + 1, result_start - score_start - 1));
+        result = stod(line.substr(result_start + 1));
+    }
+    catch (exception &e)
+    {
+        return nullopt;
+    }
+    if (result != 0 && result != 0.5 && result != 1)
+    {
+        return nullopt;
+    }
+    const BitBoard board(line.substr(0, score_start));
+    if (__builtin_popcountll(board[piece_t::white_king]) != 1 ||
+        __builtin_popcountll(board[piece_t::black_king]) != 1 ||
+        __builtin_popcountll(board[piece_t::all_pcs]) > 32)
+    {
+        return nullopt;
+    }
+    return pack_position(board, score, static_cast<uint8_t>(result * 2));
+}
+
+auto unpack_fen(const packed_position_t &position) -> string
+{
+    array<char, BitBoard::num_squares> squares{};
+    squares.fill(' ');
+    for_each_piece(position, [&squares](const piece_t piece, const int sq)
+                   { squares.at(sq) = piece_chars.at(static_cast<size_t>(piece)); });
+
+    // fens run from a8 to h1, which is the bitboard's squares backwards
+    string fen;
+    for (int rank = 7; rank >= 0; rank--)
+    {
+        int empty = 0;
+        for (int sq = (rank * 8) + 7; sq >= rank * 8; sq--)
+        {
+            if (squares.at(sq) == ' ')
+            {
+                empty++;
+                continue;
+            }
+            if (empty > 0)
+            {
+                fen += static_cast<char>('0' + empty);
+                empty = 0;
+            }
+            fen += squares.at(sq);
+        }
+        if (empty > 0)
+        {
+            fen += static_cast<char>('0' + empty);
+        }
+        if (rank > 0)
+        {
+            fen += '/';
+        }
+    }
+    fen += position.white_to_move != 0 ? " w - - 0 1" : " b - - 0 1";
+    return fen;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "bitboard.h"
+
+// Training positions as stored by ElwellTrain, 32 bytes each so a file of them can be mapped and
+// indexed directly. The pieces are listed in the order of their squares from h1 up to a8, two to a
+// byte, which is enough for the 32 pieces a position can have
+struct packed_position_t
+{
+    uint64_t occupied;
+    std::array<uint8_t, 16> pieces;
+    // the search score from white's side in centipawns
+    int16_t score;
+    // 0 if white went on to lose, 1 for a draw and 2 for a win
+    uint8_t result;
+    uint8_t white_to_move;
+    uint32_t reserved;
+};
+static_assert(sizeof(packed_position_t) == 32, "training files are read by index");
+
+auto pack_position(const BitBoard &board, int score, uint8_t result) -> packed_position_t;
+
+// A line of "fen;score;result" with the score from white's side in centipawns and the result as
+// 1, 0.5 or 0 for white. Castling rights and en passent squares don't change the features, so the
+// fen may leave them out
+auto parse_training_line(const std::string &line) -> std::optional<packed_position_t>;
+
+// the position's pieces and side to move as a fen, for building a BitBoard back from it
+auto unpack_fen(const packed_position_t &position) -> std::string;
+
+// calls visit(piece, sq) for every piece in the position
+template <typename Visit>
+void for_each_piece(const packed_position_t &position, Visit &&visit)
+{
+    uint64_t occupied = position.occupied;
+    for (size_t idx = 0; occupied != 0; idx++, occupied &= occupied - 1)
+    {
+        const uint8_t packed = position.pieces[idx / 2];
+        visit(static_cast<piece_t>(idx % 2 == 0 ? packed & 0xF : packed >> 4),
+              std::countr_zero(occupied));
+    }
+}